@@ -0,0 +1,594 @@
+/**
+ * a linked_hashmap stored like the compact dict of CPython
+ */
+#ifndef SJTU_COMPACT_LINKEDHASHMAP_HPP
+#define SJTU_COMPACT_LINKEDHASHMAP_HPP
+
+#include "linked_hashmap.hpp"
+
+namespace sjtu {
+    /**
+     * compact_linked_hashmap has the interface and the iteration order of
+     * linked_hashmap, but no linked list: the entries are kept contiguously
+     * in insertion order, and a small open-addressing table of indices
+     * points into them. Ordered iteration is a linear scan.
+     *
+     * erase() destroys the element and leaves a tombstone in its place;
+     * tombstones are squeezed out when the entry array runs full.
+     * That compaction (like any growth) moves the elements, so every
+     * insert may invalidate all iterators, like std::vector.
+     * erase() only invalidates iterators to the erased element.
+     */
+template<
+	class Key,
+	class T,
+	class Hash = std::hash<Key>,
+	class Equal = std::equal_to<Key>,
+	class Allocator = pool_allocator<pair<const Key, T> >,
+	class BucketPolicy = pow2_mix_bucket
+> class compact_linked_hashmap {
+public:
+	typedef pair<const Key, T> value_type;
+	typedef Allocator allocator_type;
+
+private:
+	static_assert(BucketPolicy::power_of_two, "compact_linked_hashmap needs power-of-two index tables");
+
+	struct Entry {
+		size_t hash;
+		bool alive;
+		alignas(value_type) unsigned char storage[sizeof(value_type)];
+
+		value_type & data() {
+			return *reinterpret_cast<value_type *>(storage);
+		}
+
+		const value_type & data() const {
+			return *reinterpret_cast<const value_type *>(storage);
+		}
+	};
+
+	typedef typename rebind_alloc<Allocator, Entry>::type entry_allocator;
+	typedef typename rebind_alloc<Allocator, size_t>::type index_allocator;
+
+	static const size_t EMPTY = size_t(-1);
+	static const size_t DUMMY = size_t(-2);
+	static const size_t INITIAL_INDEX_SIZE = 8;
+
+	Entry *entries;
+	size_t entries_capacity;
+	size_t entries_used;
+	size_t first_live;
+	size_t *indices;
+	size_t index_size;
+	size_t element_count;
+	Hash hash_func;
+	Equal equal_func;
+	BucketPolicy bucket_policy;
+	entry_allocator entry_alloc;
+	index_allocator index_alloc;
+
+	/**
+	 * two thirds of the index table may point at entries.
+	 */
+	static size_t usable(size_t size) {
+		return size * 2 / 3;
+	}
+
+	size_t hash_of(const Key &key) const {
+		return bucket_policy.mix(hash_func(key));
+	}
+
+	/**
+	 * the probe sequence of CPython: every bit of the hash takes part
+	 * before the sequence degrades into visiting every slot.
+	 */
+	struct probe {
+		size_t pos;
+		size_t perturb;
+		size_t mask;
+
+		probe(size_t hash, size_t size) : pos(hash & (size - 1)), perturb(hash), mask(size - 1) {}
+
+		void next() {
+			perturb >>= 5;
+			pos = (pos * 5 + perturb + 1) & mask;
+		}
+	};
+
+	/**
+	 * fresh, empty arrays for an index table of size slots.
+	 * if an allocation throws, the map is left as it was.
+	 */
+	void allocate(size_t size) {
+		size_t *fresh_indices = index_alloc.allocate(size);
+		Entry *fresh_entries;
+		SJTU_TRY {
+			fresh_entries = entry_alloc.allocate(usable(size));
+		} SJTU_CATCH_ALL {
+			index_alloc.deallocate(fresh_indices, size);
+			SJTU_RETHROW;
+		}
+		for (size_t i = 0; i < size; ++i) {
+			fresh_indices[i] = EMPTY;
+		}
+		index_size = size;
+		indices = fresh_indices;
+		entries_capacity = usable(size);
+		entries = fresh_entries;
+		entries_used = 0;
+		first_live = 0;
+	}
+
+	void deallocate() {
+		destroy_entries();
+		index_alloc.deallocate(indices, index_size);
+		entry_alloc.deallocate(entries, entries_capacity);
+	}
+
+	void destroy_entries() {
+		for (size_t i = 0; i < entries_used; ++i) {
+			if (entries[i].alive) entries[i].data().~value_type();
+		}
+	}
+
+	size_t find_entry(const Key &key, size_t hash) const {
+		for (probe p(hash, index_size); ; p.next()) {
+			size_t idx = indices[p.pos];
+			if (idx == EMPTY) return EMPTY;
+			if (idx != DUMMY && entries[idx].hash == hash && equal_func(entries[idx].data().first, key)) {
+				return idx;
+			}
+		}
+	}
+
+	size_t find_slot_of(size_t idx) const {
+		probe p(entries[idx].hash, index_size);
+		while (indices[p.pos] != idx) p.next();
+		return p.pos;
+	}
+
+	void place(size_t idx) {
+		probe p(entries[idx].hash, index_size);
+		while (indices[p.pos] != EMPTY) p.next();
+		indices[p.pos] = idx;
+	}
+
+	/**
+	 * moves the live entries into fresh arrays with room for capacity
+	 * entries, dropping every tombstone.
+	 */
+	void compact(size_t capacity) {
+		Entry *old_entries = entries;
+		size_t *old_indices = indices;
+		size_t old_capacity = entries_capacity;
+		size_t old_used = entries_used;
+		size_t old_index_size = index_size;
+
+		size_t size = INITIAL_INDEX_SIZE;
+		while (usable(size) < capacity) size <<= 1;
+		allocate(size);
+
+		for (size_t i = 0; i < old_used; ++i) {
+			Entry &from = old_entries[i];
+			if (!from.alive) continue;
+			Entry &to = entries[entries_used];
+			to.hash = from.hash;
+			to.alive = true;
+			new (to.storage) value_type(std::move(from.data()));
+			from.data().~value_type();
+			place(entries_used++);
+		}
+
+		index_alloc.deallocate(old_indices, old_index_size);
+		entry_alloc.deallocate(old_entries, old_capacity);
+	}
+
+	size_t append(const value_type &value, size_t hash) {
+		if (entries_used == entries_capacity) compact(element_count * 3 + 1);
+		Entry &entry = entries[entries_used];
+		new (entry.storage) value_type(value);
+		entry.hash = hash;
+		entry.alive = true;
+		place(entries_used);
+		++element_count;
+		return entries_used++;
+	}
+
+	size_t next_live(size_t idx) const {
+		while (idx < entries_used && !entries[idx].alive) ++idx;
+		return idx;
+	}
+
+	size_t begin_index() const {
+		return first_live;
+	}
+
+public:
+	/**
+	 * see BidirectionalIterator at CppReference for help.
+	 *
+	 * if there is anything wrong throw invalid_iterator.
+	 */
+	class const_iterator;
+	class iterator {
+	private:
+		size_t idx;
+		compact_linked_hashmap *map;
+
+		friend class compact_linked_hashmap;
+		friend class const_iterator;
+	public:
+		using difference_type = std::ptrdiff_t;
+		using value_type = typename compact_linked_hashmap::value_type;
+		using pointer = value_type*;
+		using reference = value_type&;
+		using iterator_category = std::bidirectional_iterator_tag;
+
+		iterator() : idx(0), map(nullptr) {}
+		iterator(size_t i, compact_linked_hashmap *m) : idx(i), map(m) {}
+
+		iterator operator++(int) {
+			iterator temp = *this;
+			++*this;
+			return temp;
+		}
+
+		iterator & operator++() {
+			SJTU_CHECK(map && idx < map->entries_used, invalid_iterator);
+			idx = map->next_live(idx + 1);
+			return *this;
+		}
+
+		iterator operator--(int) {
+			iterator temp = *this;
+			--*this;
+			return temp;
+		}
+
+		iterator & operator--() {
+			SJTU_CHECK(map, invalid_iterator);
+			size_t prev = idx;
+			while (prev > map->first_live && !map->entries[--prev].alive) {}
+			SJTU_CHECK(prev != idx && map->entries[prev].alive, invalid_iterator);
+			idx = prev;
+			return *this;
+		}
+
+		value_type & operator*() const {
+			return map->entries[idx].data();
+		}
+
+		bool operator==(const iterator &rhs) const {
+			return idx == rhs.idx && map == rhs.map;
+		}
+
+		bool operator==(const const_iterator &rhs) const {
+			return idx == rhs.idx && map == rhs.map;
+		}
+
+		bool operator!=(const iterator &rhs) const {
+			return !(*this == rhs);
+		}
+
+		bool operator!=(const const_iterator &rhs) const {
+			return !(*this == rhs);
+		}
+
+		value_type* operator->() const noexcept {
+			return &map->entries[idx].data();
+		}
+	};
+
+	class const_iterator {
+		private:
+			size_t idx;
+			const compact_linked_hashmap *map;
+
+			friend class compact_linked_hashmap;
+			friend class iterator;
+		public:
+			using difference_type = std::ptrdiff_t;
+			using value_type = typename compact_linked_hashmap::value_type;
+			using pointer = const value_type*;
+			using reference = const value_type&;
+			using iterator_category = std::bidirectional_iterator_tag;
+
+			const_iterator() : idx(0), map(nullptr) {}
+			const_iterator(size_t i, const compact_linked_hashmap *m) : idx(i), map(m) {}
+			const_iterator(const iterator &other) : idx(other.idx), map(other.map) {}
+
+			const_iterator operator++(int) {
+				const_iterator temp = *this;
+				++*this;
+				return temp;
+			}
+
+			const_iterator & operator++() {
+				SJTU_CHECK(map && idx < map->entries_used, invalid_iterator);
+				idx = map->next_live(idx + 1);
+				return *this;
+			}
+
+			const_iterator operator--(int) {
+				const_iterator temp = *this;
+				--*this;
+				return temp;
+			}
+
+			const_iterator & operator--() {
+				SJTU_CHECK(map, invalid_iterator);
+				size_t prev = idx;
+				while (prev > map->first_live && !map->entries[--prev].alive) {}
+				SJTU_CHECK(prev != idx && map->entries[prev].alive, invalid_iterator);
+				idx = prev;
+				return *this;
+			}
+
+			const value_type & operator*() const {
+				return map->entries[idx].data();
+			}
+
+			bool operator==(const iterator &rhs) const {
+				return idx == rhs.idx && map == rhs.map;
+			}
+
+			bool operator==(const const_iterator &rhs) const {
+				return idx == rhs.idx && map == rhs.map;
+			}
+
+			bool operator!=(const iterator &rhs) const {
+				return !(*this == rhs);
+			}
+
+			bool operator!=(const const_iterator &rhs) const {
+				return !(*this == rhs);
+			}
+
+			const value_type* operator->() const noexcept {
+				return &map->entries[idx].data();
+			}
+	};
+
+	compact_linked_hashmap() : element_count(0) {
+		allocate(INITIAL_INDEX_SIZE);
+	}
+
+	explicit compact_linked_hashmap(const Allocator &alloc)
+		: element_count(0), entry_alloc(alloc), index_alloc(alloc) {
+		allocate(INITIAL_INDEX_SIZE);
+	}
+
+	compact_linked_hashmap(const compact_linked_hashmap &other)
+		: element_count(0), hash_func(other.hash_func), equal_func(other.equal_func), bucket_policy(other.bucket_policy),
+		  entry_alloc(select_on_copy(other.entry_alloc)), index_alloc(select_on_copy(other.index_alloc)) {
+		size_t size = INITIAL_INDEX_SIZE;
+		while (usable(size) < other.element_count) size <<= 1;
+		allocate(size);
+		SJTU_TRY {
+			for (size_t i = other.first_live; i < other.entries_used; ++i) {
+				if (other.entries[i].alive) append(other.entries[i].data(), other.entries[i].hash);
+			}
+		} SJTU_CATCH_ALL {
+			deallocate();
+			SJTU_RETHROW;
+		}
+	}
+
+	/**
+	 * copies other (its hash, equality and bucket policy included) and
+	 *   swaps the copy in, so *this is left alone if copying throws.
+	 */
+	compact_linked_hashmap & operator=(const compact_linked_hashmap &other) {
+		if (this == &other) return *this;
+		compact_linked_hashmap copy(other);
+		swap(copy);
+		return *this;
+	}
+
+	/**
+	 * steals the arrays of other, leaving it empty with a small table of
+	 *   its own. Unlike linked_hashmap, whose empty state is a pair of
+	 *   sentinels inside the map, a compact map always owns its arrays, so
+	 *   the move allocates that table and is not noexcept.
+	 * iterators into other keep pointing at the elements,
+	 *   but must not be used with either map any more.
+	 */
+	compact_linked_hashmap(compact_linked_hashmap &&other)
+		: element_count(0), hash_func(other.hash_func), equal_func(other.equal_func), bucket_policy(other.bucket_policy),
+		  entry_alloc(other.entry_alloc), index_alloc(other.index_alloc) {
+		allocate(INITIAL_INDEX_SIZE);
+		swap(other);
+	}
+
+	/**
+	 * takes the arrays of other and hands it the old ones, emptied.
+	 */
+	compact_linked_hashmap & operator=(compact_linked_hashmap &&other) noexcept {
+		if (this == &other) return *this;
+		swap(other);
+		other.clear();
+		return *this;
+	}
+
+	/**
+	 * exchanges the contents (and allocators) of two maps in O(1).
+	 * like a move, it invalidates the iterators of both maps.
+	 */
+	void swap(compact_linked_hashmap &other) noexcept {
+		std::swap(entries, other.entries);
+		std::swap(entries_capacity, other.entries_capacity);
+		std::swap(entries_used, other.entries_used);
+		std::swap(first_live, other.first_live);
+		std::swap(indices, other.indices);
+		std::swap(index_size, other.index_size);
+		std::swap(element_count, other.element_count);
+		std::swap(hash_func, other.hash_func);
+		std::swap(equal_func, other.equal_func);
+		std::swap(bucket_policy, other.bucket_policy);
+		std::swap(entry_alloc, other.entry_alloc);
+		std::swap(index_alloc, other.index_alloc);
+	}
+
+	friend void swap(compact_linked_hashmap &lhs, compact_linked_hashmap &rhs) noexcept {
+		lhs.swap(rhs);
+	}
+
+	~compact_linked_hashmap() {
+		deallocate();
+	}
+
+	allocator_type get_allocator() const {
+		return allocator_type(entry_alloc);
+	}
+
+	/**
+	 * access specified element with bounds checking
+	 * If no such element exists, an exception of type `index_out_of_bound'
+	 */
+	T & at(const Key &key) {
+		size_t idx = find_entry(key, hash_of(key));
+		SJTU_CHECK(idx != EMPTY, index_out_of_bound);
+		return entries[idx].data().second;
+	}
+
+	const T & at(const Key &key) const {
+		size_t idx = find_entry(key, hash_of(key));
+		SJTU_CHECK(idx != EMPTY, index_out_of_bound);
+		return entries[idx].data().second;
+	}
+
+	/**
+	 * access specified element, performing an insertion if such key does not already exist.
+	 */
+	T & operator[](const Key &key) {
+		size_t hash = hash_of(key);
+		size_t idx = find_entry(key, hash);
+		if (idx == EMPTY) idx = append(value_type(key, T()), hash);
+		return entries[idx].data().second;
+	}
+
+	/**
+	 * behave like at() throw index_out_of_bound if such key does not exist.
+	 */
+	const T & operator[](const Key &key) const {
+		return at(key);
+	}
+
+	iterator begin() {
+		return iterator(begin_index(), this);
+	}
+
+	const_iterator cbegin() const {
+		return const_iterator(begin_index(), this);
+	}
+
+	iterator end() {
+		return iterator(entries_used, this);
+	}
+
+	const_iterator cend() const {
+		return const_iterator(entries_used, this);
+	}
+
+	bool empty() const {
+		return element_count == 0;
+	}
+
+	size_t size() const {
+		return element_count;
+	}
+
+	/**
+	 * call f(value_type &) on the elements in slice part of parts of the
+	 *   entry array, in insertion order; the slices together visit every
+	 *   element once, so several threads may scan their own at once.
+	 */
+	template<class F>
+	void for_each_in_slice(size_t part, size_t parts, F f) {
+		for (size_t i = slice_begin(entries_used, part, parts); i < slice_begin(entries_used, part + 1, parts); ++i) {
+			if (entries[i].alive) f(entries[i].data());
+		}
+	}
+
+	template<class F>
+	void for_each_in_slice(size_t part, size_t parts, F f) const {
+		for (size_t i = slice_begin(entries_used, part, parts); i < slice_begin(entries_used, part + 1, parts); ++i) {
+			if (entries[i].alive) f(static_cast<const value_type &>(entries[i].data()));
+		}
+	}
+
+	/**
+	 * makes room for count elements, so inserting them never compacts.
+	 * invalidates iterators if the arrays have to move.
+	 */
+	void reserve(size_t count) {
+		if (entries_capacity - entries_used + element_count < count) compact(count);
+	}
+
+	/**
+	 * drops every tombstone and shrinks the arrays to fit the elements.
+	 * invalidates iterators.
+	 */
+	void shrink_to_fit() {
+		compact(element_count);
+	}
+
+	/**
+	 * clears the contents, keeping the arrays for reuse.
+	 */
+	void clear() {
+		destroy_entries();
+		for (size_t i = 0; i < index_size; ++i) {
+			indices[i] = EMPTY;
+		}
+		entries_used = 0;
+		first_live = 0;
+		element_count = 0;
+	}
+
+	/**
+	 * insert an element.
+	 * return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 */
+	pair<iterator, bool> insert(const value_type &value) {
+		size_t hash = hash_of(value.first);
+		size_t idx = find_entry(value.first, hash);
+		if (idx != EMPTY) return pair<iterator, bool>(iterator(idx, this), false);
+		return pair<iterator, bool>(iterator(append(value, hash), this), true);
+	}
+
+	/**
+	 * erase the element at pos, leaving a tombstone.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	void erase(iterator pos) {
+		SJTU_CHECK(pos.map == this && pos.idx < entries_used && entries[pos.idx].alive, invalid_iterator);
+		indices[find_slot_of(pos.idx)] = DUMMY;
+		entries[pos.idx].data().~value_type();
+		entries[pos.idx].alive = false;
+		--element_count;
+		if (pos.idx == first_live) first_live = next_live(first_live);
+	}
+
+	size_t count(const Key &key) const {
+		return find_entry(key, hash_of(key)) == EMPTY ? 0 : 1;
+	}
+
+	iterator find(const Key &key) {
+		size_t idx = find_entry(key, hash_of(key));
+		return idx == EMPTY ? end() : iterator(idx, this);
+	}
+
+	const_iterator find(const Key &key) const {
+		size_t idx = find_entry(key, hash_of(key));
+		return idx == EMPTY ? cend() : const_iterator(idx, this);
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,317 @@
+/**
+ * a linked_hashmap that many threads may use at once
+ */
+#ifndef SJTU_CONCURRENT_LINKEDHASHMAP_HPP
+#define SJTU_CONCURRENT_LINKEDHASHMAP_HPP
+
+#include "linked_hashmap.hpp"
+#include "rcu_linked_hashmap.hpp"
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <algorithm>
+
+namespace sjtu {
+    /**
+     * concurrent_linked_hashmap splits its elements over a fixed number of
+     * shards by hash. Each shard is an rcu_linked_hashmap, so readers
+     * (find, count, visit, size) never lock and never write a cache line
+     * other than their own epoch slot: they scale with the threads reading.
+     * Writers of one shard take its mutex; writers of different shards
+     * never meet, except for a short lock when they retire memory.
+     * All shards share one epoch_domain.
+     *
+     * A global sequence number stamped on every insert remembers the
+     * insertion order across shards; ordered traversals merge the shards
+     * by it. Re-inserting or assigning a key keeps its place, like
+     * linked_hashmap.
+     *
+     * Values are never changed in place (see rcu_linked_hashmap): update
+     * and insert_or_assign put a new copy in, so a reader sees a whole old
+     * value or a whole new one.
+     *
+     * There are no iterators: a reference into a shard would outlive its
+     * epoch. Elements are read by copy (find) or inside a callback (visit,
+     * update, for_each), and a callback of update must not call back into
+     * the map.
+     */
+template<
+	class Key,
+	class T,
+	class Hash = std::hash<Key>,
+	class Equal = std::equal_to<Key>
+> class concurrent_linked_hashmap {
+public:
+	typedef pair<const Key, T> value_type;
+
+private:
+	struct Entry {
+		unsigned long long seq;
+		T value;
+
+		template<class... Args>
+		Entry(unsigned long long seq, Args&&... args) : seq(seq), value(std::forward<Args>(args)...) {}
+	};
+
+	typedef rcu_linked_hashmap<Key, Entry, Hash, Equal> shard_map;
+	typedef typename shard_map::read_guard read_guard;
+
+	/**
+	 * a cache line each, so that writing one shard does not slow down
+	 *   its neighbours.
+	 */
+	struct alignas(64) Shard {
+		std::mutex lock;
+		shard_map map;
+
+		explicit Shard(epoch_domain &epochs) : map(epochs) {}
+	};
+
+	static const size_t DEFAULT_SHARD_COUNT = 64;
+
+	epoch_domain epochs;
+	Shard *shards;
+	size_t shard_count;
+	size_t shard_shift;
+	Hash hash_func;
+	std::atomic<unsigned long long> next_seq;
+
+	/**
+	 * the shard of key. The top bits of the mixed hash pick it,
+	 *   the shard map indexes by the low bits, so the two do not correlate.
+	 */
+	Shard & shard_of(const Key &key) const {
+		size_t hash = pow2_mix_bucket::mix(hash_func(key));
+		return shards[shard_shift == sizeof(size_t) * 8 ? 0 : hash >> shard_shift];
+	}
+
+	unsigned long long stamp() {
+		return next_seq.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/**
+	 * an element seen by an ordered traversal.
+	 */
+	struct Item {
+		unsigned long long seq;
+		const Key *key;
+		const T *value;
+
+		bool operator<(const Item &rhs) const {
+			return seq < rhs.seq;
+		}
+	};
+
+public:
+	/**
+	 * shard_count is rounded up to a power of two.
+	 * More shards than threads keeps two writers off the same lock.
+	 */
+	explicit concurrent_linked_hashmap(size_t shard_count = DEFAULT_SHARD_COUNT) : next_seq(0) {
+		this->shard_count = pow2_mix_bucket::bucket_count_for(shard_count ? shard_count : 1);
+		shard_shift = sizeof(size_t) * 8;
+		for (size_t n = this->shard_count; n > 1; n >>= 1) --shard_shift;
+		shards = static_cast<Shard *>(::operator new(sizeof(Shard) * this->shard_count, std::align_val_t(alignof(Shard))));
+		for (size_t i = 0; i < this->shard_count; ++i) new (shards + i) Shard(epochs);
+	}
+
+	concurrent_linked_hashmap(const concurrent_linked_hashmap &) = delete;
+	concurrent_linked_hashmap & operator=(const concurrent_linked_hashmap &) = delete;
+
+	/**
+	 * no other thread may still use the map.
+	 */
+	~concurrent_linked_hashmap() {
+		for (size_t i = 0; i < shard_count; ++i) shards[i].~Shard();
+		::operator delete(shards, std::align_val_t(alignof(Shard)));
+	}
+
+	size_t shards_used() const {
+		return shard_count;
+	}
+
+	/**
+	 * insert (key, value) unless key is present.
+	 * return true if it was inserted.
+	 */
+	bool insert(const Key &key, const T &value) {
+		Shard &shard = shard_of(key);
+		std::lock_guard<std::mutex> guard(shard.lock);
+		return shard.map.try_emplace(key, stamp(), value);
+	}
+
+	/**
+	 * insert (key, T(args...)) unless key is present.
+	 * return true if it was inserted.
+	 */
+	template<class... Args>
+	bool try_emplace(const Key &key, Args&&... args) {
+		Shard &shard = shard_of(key);
+		std::lock_guard<std::mutex> guard(shard.lock);
+		return shard.map.try_emplace(key, stamp(), std::forward<Args>(args)...);
+	}
+
+	/**
+	 * insert (key, value), or assign value if key is present (keeping its order).
+	 * return true if it was inserted.
+	 */
+	template<class M>
+	bool insert_or_assign(const Key &key, M &&value) {
+		Shard &shard = shard_of(key);
+		std::lock_guard<std::mutex> guard(shard.lock);
+		read_guard pinned = shard.map.pin();
+		const Entry *found = shard.map.find(key, pinned);
+		if (found) {
+			shard.map.insert_or_assign(key, Entry(found->seq, std::forward<M>(value)));
+			return false;
+		}
+		return shard.map.try_emplace(key, stamp(), std::forward<M>(value));
+	}
+
+	/**
+	 * copy the value of key into out.
+	 * return false (leaving out alone) if key is missing.
+	 */
+	bool find(const Key &key, T &out) const {
+		Shard &shard = shard_of(key);
+		read_guard pinned = shard.map.pin();
+		const Entry *found = shard.map.find(key, pinned);
+		if (!found) return false;
+		out = found->value;
+		return true;
+	}
+
+	size_t count(const Key &key) const {
+		Shard &shard = shard_of(key);
+		read_guard pinned = shard.map.pin();
+		return shard.map.find(key, pinned) ? 1 : 0;
+	}
+
+	/**
+	 * call f(const T &) on the value of key, without a lock.
+	 * return false if key is missing.
+	 */
+	template<class F>
+	bool visit(const Key &key, F f) const {
+		Shard &shard = shard_of(key);
+		read_guard pinned = shard.map.pin();
+		const Entry *found = shard.map.find(key, pinned);
+		if (!found) return false;
+		f(found->value);
+		return true;
+	}
+
+	/**
+	 * call f(T &) on a copy of the value of key, under the lock of its
+	 *   shard, and put the copy in its place.
+	 * return false if key is missing.
+	 */
+	template<class F>
+	bool update(const Key &key, F f) {
+		Shard &shard = shard_of(key);
+		std::lock_guard<std::mutex> guard(shard.lock);
+		read_guard pinned = shard.map.pin();
+		const Entry *found = shard.map.find(key, pinned);
+		if (!found) return false;
+		Entry copy(*found);
+		f(copy.value);
+		shard.map.insert_or_assign(key, std::move(copy));
+		return true;
+	}
+
+	/**
+	 * return the number of elements erased (0 or 1).
+	 */
+	size_t erase(const Key &key) {
+		Shard &shard = shard_of(key);
+		std::lock_guard<std::mutex> guard(shard.lock);
+		return shard.map.erase(key);
+	}
+
+	/**
+	 * the shards are counted one after another, so under concurrent
+	 *   updates the result is only a snapshot of some moment per shard.
+	 */
+	size_t size() const {
+		size_t total = 0;
+		for (size_t i = 0; i < shard_count; ++i) total += shards[i].map.size();
+		return total;
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	void clear() {
+		for (size_t i = 0; i < shard_count; ++i) {
+			std::lock_guard<std::mutex> guard(shards[i].lock);
+			shards[i].map.clear();
+		}
+	}
+
+	/**
+	 * make every shard ready for count elements in total.
+	 */
+	void reserve(size_t count) {
+		size_t per_shard = count / shard_count + 1;
+		for (size_t i = 0; i < shard_count; ++i) {
+			std::lock_guard<std::mutex> guard(shards[i].lock);
+			shards[i].map.reserve(per_shard);
+		}
+	}
+
+	/**
+	 * call f(const Key &, const T &) on every element, a shard at a time,
+	 *   in no particular order, alongside the writers: it sees every
+	 *   element that stays in the map throughout, and any mix of the ones
+	 *   inserted or erased meanwhile.
+	 */
+	template<class F>
+	void for_each_unordered(F f) const {
+		for (size_t i = 0; i < shard_count; ++i) {
+			shards[i].map.for_each([&](const Key &key, const Entry &entry) {
+				f(key, entry.value);
+			});
+		}
+	}
+
+	/**
+	 * call f(const Key &, const T &) on every element in insertion order.
+	 * The writers of every shard are held off for the whole traversal, so
+	 *   it sees one consistent state; readers go on meanwhile.
+	 */
+	template<class F>
+	void for_each(F f) const {
+		std::vector<std::unique_lock<std::mutex> > guards;
+		guards.reserve(shard_count);
+		for (size_t i = 0; i < shard_count; ++i) guards.emplace_back(shards[i].lock);
+
+		std::vector<Item> items;
+		items.reserve(size());
+		for (size_t i = 0; i < shard_count; ++i) {
+			shards[i].map.for_each([&](const Key &key, const Entry &entry) {
+				Item item = {entry.seq, &key, &entry.value};
+				items.push_back(item);
+			});
+		}
+		std::sort(items.begin(), items.end());
+		for (size_t i = 0; i < items.size(); ++i) f(*items[i].key, *items[i].value);
+	}
+
+	/**
+	 * a plain linked_hashmap holding the elements in insertion order.
+	 */
+	linked_hashmap<Key, T, Hash, Equal> snapshot() const {
+		linked_hashmap<Key, T, Hash, Equal> result;
+		result.reserve(size());
+		for_each([&](const Key &key, const T &value) {
+			result.try_emplace(key, value);
+		});
+		return result;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,343 @@
+/**
+ * linked_hashmap_bench: throughput of linked_hashmap against
+ * std::unordered_map plus a std::list keeping the insertion order.
+ *
+ *   linked_hashmap_bench [--min N] [--max N] [--filter TEXT] [--json]
+ *
+ * Sizes run from --min to --max (1000 to 1000000 by default, up to 1e8)
+ * in steps of ten. Every benchmark reports nanoseconds per operation;
+ * --json prints the results in the layout of google-benchmark
+ * (context + benchmarks[]), so that runs can be compared by its tools.
+ */
+#include "linked_hashmap.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * the Hash of data/testtwo/3.cpp and data/testfive/9.cpp: std::hash<int>,
+ * that is the identity, truncated to unsigned int.
+ */
+struct WeakHash {
+	unsigned int operator () (int key) const {
+		return std::hash<int>()(key);
+	}
+};
+
+/**
+ * every bit of the key reaches every bit of the hash.
+ */
+struct StrongHash {
+	size_t operator () (int key) const {
+		unsigned long long x = static_cast<unsigned int>(key);
+		x ^= x >> 16;
+		x *= 0x45d9f3bULL;
+		x ^= x >> 16;
+		x *= 0x45d9f3bULL;
+		x ^= x >> 16;
+		return static_cast<size_t>(x * 0x9e3779b97f4a7c15ULL);
+	}
+};
+
+/**
+ * the two containers behind one interface.
+ */
+template<class Hash>
+class linked_side {
+	typedef sjtu::linked_hashmap<int, int, Hash> map_type;
+	map_type map;
+
+public:
+	static const char * name() {
+		return "linked_hashmap";
+	}
+
+	void insert(int key, int value) {
+		map.insert(typename map_type::value_type(key, value));
+	}
+
+	bool find(int key) const {
+		return map.find(key) != map.cend();
+	}
+
+	void erase(int key) {
+		map.erase(key);
+	}
+
+	long long iterate() const {
+		long long sum = 0;
+		for (typename map_type::const_iterator it = map.cbegin(); it != map.cend(); ++it) sum += it->second;
+		return sum;
+	}
+
+	void rehash(size_t n) {
+		map.rehash(n);
+	}
+
+	size_t size() const {
+		return map.size();
+	}
+};
+
+template<class Hash>
+class std_side {
+	typedef std::list<std::pair<int, int> > list_type;
+	list_type order;
+	std::unordered_map<int, typename list_type::iterator, Hash> index;
+
+public:
+	std_side() {}
+
+	/**
+	 * the list iterators of other point into other, so the index is rebuilt.
+	 */
+	std_side(const std_side &other) : order(other.order) {
+		index.reserve(other.index.size());
+		for (typename list_type::iterator it = order.begin(); it != order.end(); ++it) index.emplace(it->first, it);
+	}
+
+	static const char * name() {
+		return "std_unordered_map+list";
+	}
+
+	void insert(int key, int value) {
+		if (index.count(key)) return;
+		order.emplace_back(key, value);
+		index.emplace(key, --order.end());
+	}
+
+	bool find(int key) const {
+		return index.find(key) != index.end();
+	}
+
+	void erase(int key) {
+		typename std::unordered_map<int, typename list_type::iterator, Hash>::iterator it = index.find(key);
+		if (it == index.end()) return;
+		order.erase(it->second);
+		index.erase(it);
+	}
+
+	long long iterate() const {
+		long long sum = 0;
+		for (typename list_type::const_iterator it = order.begin(); it != order.end(); ++it) sum += it->second;
+		return sum;
+	}
+
+	void rehash(size_t n) {
+		index.rehash(n);
+	}
+
+	size_t size() const {
+		return order.size();
+	}
+};
+
+struct result {
+	std::string name;
+	size_t iterations;
+	double ns_per_op;
+};
+
+struct options {
+	size_t min_size;
+	size_t max_size;
+	const char *filter;
+	bool json;
+};
+
+static volatile long long sink;
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double elapsed_ns(bench_clock::time_point start) {
+	return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+}
+
+/**
+ * keys are positive multiples of 1024 (of less for the largest sizes) in
+ *   random order: ids with structure, which the identity hash maps to few
+ *   buckets of a power-of-two table. -key is never present.
+ */
+static std::vector<int> make_keys(size_t n) {
+	int shift = 10;
+	while (shift && (static_cast<unsigned long long>(n) << shift) > 0x7fffffffULL) --shift;
+	std::vector<int> keys(n);
+	for (size_t i = 0; i < n; ++i) keys[i] = static_cast<int>((i + 1) << shift);
+	unsigned long long state = 0x9e3779b97f4a7c15ULL;
+	for (size_t i = n; i > 1; --i) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		std::swap(keys[i - 1], keys[state % i]);
+	}
+	return keys;
+}
+
+/**
+ * the number of rounds that makes about ten million operations.
+ */
+static size_t rounds_for(size_t n) {
+	size_t rounds = 10000000 / n;
+	return rounds ? rounds : 1;
+}
+
+template<class Map>
+static void fill(Map &map, const std::vector<int> &keys) {
+	for (size_t i = 0; i < keys.size(); ++i) map.insert(keys[i], static_cast<int>(i));
+}
+
+template<class Map>
+static void run_size(const char *hasher, size_t n, const options &opt, std::vector<result> &results) {
+	std::vector<int> keys = make_keys(n);
+	size_t rounds = rounds_for(n);
+	std::string suffix = std::string("/") + Map::name() + "/" + hasher + "/" + std::to_string(n);
+
+	auto record = [&](const char *op, size_t ops, double ns) {
+		result r = {std::string(op) + suffix, ops, ns / ops};
+		results.push_back(r);
+	};
+	auto wanted = [&](const char *op) {
+		return !opt.filter || (std::string(op) + suffix).find(opt.filter) != std::string::npos;
+	};
+
+	if (wanted("insert")) {
+		double ns = 0;
+		for (size_t r = 0; r < rounds; ++r) {
+			Map map;
+			bench_clock::time_point start = bench_clock::now();
+			fill(map, keys);
+			ns += elapsed_ns(start);
+		}
+		record("insert", n * rounds, ns);
+	}
+
+	Map map;
+	fill(map, keys);
+
+	if (wanted("find_hit")) {
+		long long found = 0;
+		bench_clock::time_point start = bench_clock::now();
+		for (size_t r = 0; r < rounds; ++r) {
+			for (size_t i = 0; i < n; ++i) found += map.find(keys[i]);
+		}
+		record("find_hit", n * rounds, elapsed_ns(start));
+		sink = found;
+	}
+
+	if (wanted("find_miss")) {
+		long long found = 0;
+		bench_clock::time_point start = bench_clock::now();
+		for (size_t r = 0; r < rounds; ++r) {
+			for (size_t i = 0; i < n; ++i) found += map.find(-keys[i]);
+		}
+		record("find_miss", n * rounds, elapsed_ns(start));
+		sink = found;
+	}
+
+	if (wanted("erase_churn")) {
+		bench_clock::time_point start = bench_clock::now();
+		for (size_t r = 0; r < rounds; ++r) {
+			for (size_t i = 0; i < n; ++i) {
+				map.erase(keys[i]);
+				map.insert(keys[i], static_cast<int>(r));
+			}
+		}
+		record("erase_churn", n * rounds, elapsed_ns(start));
+	}
+
+	if (wanted("iterate")) {
+		long long sum = 0;
+		bench_clock::time_point start = bench_clock::now();
+		for (size_t r = 0; r < rounds; ++r) sum += map.iterate();
+		record("iterate", n * rounds, elapsed_ns(start));
+		sink = sum;
+	}
+
+	if (wanted("copy")) {
+		size_t copy_rounds = rounds > 10 ? rounds / 10 : 1;
+		double ns = 0;
+		for (size_t r = 0; r < copy_rounds; ++r) {
+			bench_clock::time_point start = bench_clock::now();
+			Map copy(map);
+			ns += elapsed_ns(start);
+			sink = static_cast<long long>(copy.size());
+		}
+		record("copy", n * copy_rounds, ns);
+	}
+
+	if (wanted("rehash")) {
+		size_t rehash_rounds = rounds > 10 ? rounds / 10 : 1;
+		bench_clock::time_point start = bench_clock::now();
+		for (size_t r = 0; r < rehash_rounds; ++r) {
+			map.rehash(n * 4);
+			map.rehash(0);
+		}
+		record("rehash", n * rehash_rounds * 2, elapsed_ns(start));
+	}
+}
+
+static void print_table(const std::vector<result> &results) {
+	std::printf("%-56s %14s %14s\n", "Benchmark", "ns/op", "Iterations");
+	for (size_t i = 0; i < results.size(); ++i) {
+		std::printf("%-56s %14.2f %14zu\n", results[i].name.c_str(), results[i].ns_per_op, results[i].iterations);
+	}
+}
+
+static void print_json(const std::vector<result> &results) {
+	std::printf("{\n  \"context\": {\n    \"executable\": \"linked_hashmap_bench\",\n");
+	std::printf("    \"library_build_type\": \"%s\"\n  },\n",
+#ifdef NDEBUG
+		"release"
+#else
+		"debug"
+#endif
+	);
+	std::printf("  \"benchmarks\": [\n");
+	for (size_t i = 0; i < results.size(); ++i) {
+		std::printf("    {\"name\": \"%s\", \"run_type\": \"iteration\", \"iterations\": %zu, "
+			"\"real_time\": %.3f, \"cpu_time\": %.3f, \"time_unit\": \"ns\"}%s\n",
+			results[i].name.c_str(), results[i].iterations, results[i].ns_per_op, results[i].ns_per_op,
+			i + 1 < results.size() ? "," : "");
+	}
+	std::printf("  ]\n}\n");
+}
+
+int main(int argc, char **argv) {
+	options opt = {1000, 1000000, nullptr, false};
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "--json")) {
+			opt.json = true;
+		} else if (!std::strcmp(argv[i], "--min") && i + 1 < argc) {
+			opt.min_size = std::strtoull(argv[++i], nullptr, 10);
+		} else if (!std::strcmp(argv[i], "--max") && i + 1 < argc) {
+			opt.max_size = std::strtoull(argv[++i], nullptr, 10);
+		} else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc) {
+			opt.filter = argv[++i];
+		} else {
+			std::fprintf(stderr, "usage: %s [--min N] [--max N] [--filter TEXT] [--json]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (opt.min_size == 0) opt.min_size = 1;
+	if (opt.max_size > 100000000) opt.max_size = 100000000;
+
+	std::vector<result> results;
+	for (size_t n = opt.min_size; n <= opt.max_size; n *= 10) {
+		run_size<linked_side<WeakHash> >("weak", n, opt, results);
+		run_size<std_side<WeakHash> >("weak", n, opt, results);
+		run_size<linked_side<StrongHash> >("strong", n, opt, results);
+		run_size<std_side<StrongHash> >("strong", n, opt, results);
+	}
+	if (opt.json) {
+		print_json(results);
+	} else {
+		print_table(results);
+	}
+	return 0;
+}
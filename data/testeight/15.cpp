@@ -0,0 +1,356 @@
+#include "linked_hashmap.hpp"
+#include <iostream>
+#include <type_traits>
+#include <utility>
+#include <cassert>
+#include <cmath>
+#include <string>
+#include <vector>
+class Integer {
+public:
+	static int counter;
+	int val;
+	
+	Integer(int val) : val(val) {
+		counter++;
+	}
+
+	Integer(const Integer &rhs) {
+		val = rhs.val;
+		counter++;
+	}
+
+	Integer& operator = (const Integer &rhs) {
+		assert(false);
+	}
+
+	~Integer() {
+		counter--;
+	}
+};
+
+int Integer::counter = 0;
+
+class Equal {
+public:
+	bool operator () (const Integer &lhs, const Integer &rhs) const {
+		return lhs.val == rhs.val;
+	}
+};
+class Hash {
+public:
+	static int calls;
+	unsigned int operator () (const Integer &lhs) const {
+		calls++;
+		return std::hash<int>()(lhs.val);
+	}
+};
+int Hash::calls = 0;
+class Value {
+public:
+	static int built;
+	std::string str;
+	Value() {
+		built++;
+	}
+	Value(int n, char c) : str(n, c) {
+		built++;
+	}
+	Value(const Value &rhs) : str(rhs.str) {
+		built++;
+	}
+	Value(Value &&rhs) : str(std::move(rhs.str)) {}
+	Value & operator = (const Value &rhs) {
+		str = rhs.str;
+		return *this;
+	}
+	Value & operator = (Value &&rhs) {
+		str = std::move(rhs.str);
+		return *this;
+	}
+};
+int Value::built = 0;
+typedef sjtu::linked_hashmap<Integer, Value, Hash, Equal> Map;
+class Name {
+public:
+	static int built;
+	std::string str;
+	Name(const char *s) : str(s) {
+		built++;
+	}
+	Name(const Name &rhs) : str(rhs.str) {
+		built++;
+	}
+};
+int Name::built = 0;
+class NameHash {
+public:
+	typedef void is_transparent;
+	size_t operator () (const char *s) const {
+		size_t h = 5381;
+		while (*s) h = h * 33 + (unsigned char)*s++;
+		return h;
+	}
+	size_t operator () (const Name &name) const {
+		return (*this)(name.str.c_str());
+	}
+};
+class NameEqual {
+public:
+	typedef void is_transparent;
+	bool operator () (const Name &lhs, const Name &rhs) const {
+		return lhs.str == rhs.str;
+	}
+	bool operator () (const Name &lhs, const char *rhs) const {
+		return lhs.str == rhs;
+	}
+};
+/**
+ * transparent functors that accept anything, even an iterator.
+ */
+class GreedyHash : public NameHash {
+public:
+	using NameHash::operator ();
+	template<class U>
+	size_t operator () (const U &) const {
+		return 0;
+	}
+};
+class GreedyEqual : public NameEqual {
+public:
+	using NameEqual::operator ();
+	template<class U>
+	bool operator () (const Name &, const U &) const {
+		return false;
+	}
+};
+typedef sjtu::linked_hashmap<Name, int, GreedyHash, GreedyEqual> GreedyMap;
+template<class M, class A, class = void>
+struct can_erase : std::false_type {};
+template<class M, class A>
+struct can_erase<M, A, decltype(void(std::declval<M &>().erase(std::declval<A>())))> : std::true_type {};
+void print(const Map &map) {
+	for (Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		std::cout << it->first.val << ":" << it->second.str << " ";
+	}
+	std::cout << map.size() << std::endl;
+}
+void test_emplace() {
+	Map map;
+	for (int i = 0; i < 8; ++i) {
+		Hash::calls = 0;
+		Value::built = 0;
+		auto result = map.try_emplace(Integer(i), i + 1, 'a' + i);
+		std::cout << result.second << " " << Hash::calls << " " << Value::built << std::endl;
+	}
+	Hash::calls = 0;
+	Value::built = 0;
+	auto kept = map.try_emplace(Integer(3), 10, 'z');
+	std::cout << kept.second << " " << kept.first->second.str << " " << Hash::calls << " " << Value::built << std::endl;
+
+	Hash::calls = 0;
+	auto assigned = map.insert_or_assign(Integer(3), Value(2, 'q'));
+	std::cout << assigned.second << " " << assigned.first->second.str << " " << Hash::calls << std::endl;
+	Hash::calls = 0;
+	auto added = map.insert_or_assign(Integer(20), Value(3, 'r'));
+	std::cout << added.second << " " << added.first->second.str << " " << Hash::calls << std::endl;
+
+	Hash::calls = 0;
+	auto emplaced = map.emplace(Integer(21), Value(1, 's'));
+	std::cout << emplaced.second << " " << Hash::calls << std::endl;
+	Hash::calls = 0;
+	auto rejected = map.emplace(Integer(21), Value(1, 't'));
+	std::cout << rejected.second << " " << rejected.first->second.str << " " << Hash::calls << std::endl;
+
+	Hash::calls = 0;
+	Value::built = 0;
+	map[Integer(22)].str = "u";
+	map[Integer(22)].str += "v";
+	std::cout << Hash::calls << " " << Value::built << std::endl;
+	print(map);
+}
+void test_move() {
+	Map a;
+	for (int i = 0; i < 100; ++i) {
+		a.insert(sjtu::pair<Integer, Value>(Integer(i), Value(i % 7 + 1, 'a' + i % 26)));
+	}
+	Value::built = 0;
+	Map b(std::move(a));
+	std::cout << a.size() << " " << b.size() << " " << Value::built << std::endl;
+	a[Integer(-1)].str = "back";
+	print(a);
+
+	Map c;
+	c = std::move(b);
+	std::cout << b.size() << " " << c.size() << " " << Value::built << std::endl;
+	for (int i = 0; i < 100; i += 3) c.erase(c.find(Integer(i)));
+	std::cout << c.size() << " " << c.at(Integer(1)).str << std::endl;
+
+	swap(a, c);
+	std::cout << a.size() << " " << c.size() << std::endl;
+	print(c);
+	a.swap(b);
+	std::cout << a.size() << " " << b.size() << " " << b.count(Integer(2)) << std::endl;
+
+	Value moved(4, 'm');
+	b.insert(sjtu::pair<const Integer, Value>(Integer(500), std::move(moved)));
+	std::cout << b.at(Integer(500)).str << " [" << moved.str << "]" << std::endl;
+	int sum = 0;
+	for (Map::iterator it = b.begin(); it != b.end(); ++it) sum += it->first.val;
+	std::cout << sum << std::endl;
+}
+void test_transparent() {
+	sjtu::linked_hashmap<Name, int, NameHash, NameEqual> map;
+	const char *names[] = {"alpha", "beta", "gamma", "delta", "epsilon"};
+	for (int i = 0; i < 5; ++i) map[Name(names[i])] = i;
+	Name::built = 0;
+	std::cout << map.count("gamma") << " " << map.count("omega") << " " << map.at("delta") << " ";
+	std::cout << map.find("beta")->second << " " << (map.find("zeta") == map.end()) << std::endl;
+	const sjtu::linked_hashmap<Name, int, NameHash, NameEqual> &ref = map;
+	std::cout << ref.at("alpha") << " " << (ref.find("epsilon") != ref.cend()) << std::endl;
+	std::cout << map.erase("beta") << " " << map.erase("beta") << " " << map.size() << std::endl;
+	try {
+		map.at("beta");
+	} catch (...) {
+		std::cout << "missing" << std::endl;
+	}
+	std::cout << Name::built << std::endl;
+
+	GreedyMap greedy;
+	greedy[Name("one")] = 1;
+	greedy[Name("two")] = 2;
+	GreedyMap::iterator first = greedy.begin();
+	greedy.erase(first);
+	std::cout << greedy.size() << " " << greedy.erase("two") << " "
+		<< can_erase<GreedyMap, const char *>::value << can_erase<GreedyMap, GreedyMap::iterator>::value
+		<< can_erase<GreedyMap, GreedyMap::const_iterator>::value << std::endl;
+}
+void test_batch() {
+	Map map;
+	std::vector<sjtu::pair<const Integer, Value> > values;
+	for (int i = 0; i < 1000; ++i) {
+		values.push_back(sjtu::pair<const Integer, Value>(Integer(i * 37 % 1000), Value(i % 5 + 1, 'a' + i % 26)));
+	}
+	for (int i = 0; i < 100; ++i) {
+		values.push_back(sjtu::pair<const Integer, Value>(Integer(i), Value(1, '!')));
+	}
+	Hash::calls = 0;
+	size_t buckets = 0;
+	std::cout << map.insert_batch(values.data(), values.size()) << " " << map.size() << " " << Hash::calls << std::endl;
+	buckets = map.bucket_count();
+	std::cout << map.insert_batch(values.data(), 10) << " " << (buckets == map.bucket_count()) << std::endl;
+
+	std::vector<Integer> keys;
+	for (int i = 0; i < 150; ++i) keys.push_back(Integer(i * 13 - 500));
+	std::vector<Map::iterator> found(keys.size());
+	map.find_batch(keys.data(), keys.size(), found.data());
+	long long sum = 0;
+	int hit = 0;
+	for (size_t i = 0; i < keys.size(); ++i) {
+		if (found[i] != map.end()) {
+			++hit;
+			sum += found[i]->first.val * (long long)found[i]->second.str.size();
+			if (found[i]->first.val != keys[i].val) std::cout << "wrong" << std::endl;
+		} else if (map.count(keys[i])) {
+			std::cout << "missed" << std::endl;
+		}
+	}
+	std::vector<size_t> counts(keys.size());
+	const Map &ref = map;
+	std::vector<Map::const_iterator> const_found(keys.size());
+	ref.find_batch(keys.data(), keys.size(), const_found.data());
+	size_t total = ref.count_batch(keys.data(), keys.size(), counts.data());
+	size_t agree = 0;
+	for (size_t i = 0; i < keys.size(); ++i) {
+		if ((counts[i] == 1) == (const_found[i] != ref.cend())) ++agree;
+	}
+	std::cout << hit << " " << sum << " " << total << " " << agree << " " << ref.count_batch(keys.data(), 0) << std::endl;
+}
+int evicted = 0;
+long long evicted_sum = 0;
+void test_assign_empty() {
+	sjtu::linked_hashmap<int, int> big, empty, loose;
+	for (int i = 0; i < 10000; ++i) big[i] = i;
+	loose.max_load_factor(4.0f);
+	bool grown = big.bucket_count() > empty.bucket_count();
+	big = empty;
+	std::cout << grown << " " << big.size() << " " << (big.bucket_count() == empty.bucket_count()) << " ";
+	big[1] = 1;
+	big = loose;
+	std::cout << big.empty() << " " << big.max_load_factor() << " " << (big.bucket_count() == loose.bucket_count()) << std::endl;
+}
+void test_bad_load_factor() {
+	sjtu::linked_hashmap<int, int> map;
+	for (int i = 0; i < 100; ++i) map[i] = i;
+	map.max_load_factor(2.0f);
+	const float bad[] = {0.0f, -1.0f, std::nanf("")};
+	int rejected = 0;
+	for (int i = 0; i < 3; ++i) {
+		try {
+			map.max_load_factor(bad[i]);
+		} catch (sjtu::runtime_error &) {
+			++rejected;
+		}
+	}
+	map.reserve(1000);
+	std::cout << rejected << " " << map.max_load_factor() << " " << (map.bucket_count() >= 500) << std::endl;
+}
+void test_lru() {
+	Map cache;
+	cache.set_capacity(50, [](sjtu::pair<const Integer, Value> &entry) {
+		++evicted;
+		evicted_sum += entry.first.val;
+	});
+	for (int i = 0; i < 2000; ++i) {
+		int key = i % 3 ? (i * 13) % 30 : (i * 7919) % 97;
+		Map::iterator it = cache.find(Integer(key));
+		if (it != cache.end()) {
+			cache.touch(it);
+			it->second.str += "+";
+		} else {
+			cache.try_emplace(Integer(key), 1, 'a' + key % 26);
+		}
+		if (cache.size() > cache.capacity()) std::cout << "over" << std::endl;
+	}
+	std::cout << cache.size() << " " << evicted << " " << evicted_sum << std::endl;
+
+	Map::iterator first = cache.begin(), last = --cache.end();
+	cache.move_to_front(last);
+	cache.move_to_back(first);
+	cache.touch(first);
+	std::cout << cache.begin()->first.val << " " << (--cache.end())->first.val << " " << (first->first.val == (--cache.end())->first.val) << std::endl;
+
+	Map copy(cache);
+	copy.set_capacity(10);
+	cache.pop_front();
+	cache.pop_back();
+	std::cout << copy.size() << " " << copy.begin()->first.val << " " << cache.size() << " " << evicted << std::endl;
+	copy.try_emplace(Integer(1000));
+	std::cout << copy.size() << " " << evicted << std::endl;
+
+	cache.set_capacity(0);
+	for (int i = 0; i < 100; ++i) cache.try_emplace(Integer(1000 + i));
+	std::cout << cache.size() << " " << evicted << std::endl;
+	while (!cache.empty()) cache.pop_front();
+	try {
+		cache.pop_back();
+	} catch (...) {
+		std::cout << "empty" << std::endl;
+	}
+	try {
+		cache.touch(cache.end());
+	} catch (...) {
+		std::cout << "invalid" << std::endl;
+	}
+}
+int main() {
+	test_emplace();
+	test_move();
+	test_transparent();
+	test_batch();
+	test_assign_empty();
+	test_bad_load_factor();
+	test_lru();
+	std::cout << Integer::counter << std::endl;
+	return 0;
+}
@@ -0,0 +1,141 @@
+#include "linked_hashmap.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+class Hash {
+public:
+	size_t operator () (int key) const {
+		return static_cast<size_t>(key) * 0x9e3779b97f4a7c15ULL;
+	}
+};
+
+typedef sjtu::linked_hashmap<int, int, Hash, std::equal_to<int>, sjtu::pool_allocator<sjtu::pair<const int, int> >,
+	sjtu::pow2_mix_bucket, sjtu::chained_index, sjtu::ranked_order> map_type;
+
+template<class Map>
+void print(const char *name, const Map &map) {
+	std::cout << name << " " << map.size() << ":";
+	for (typename Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) std::cout << " " << it->first;
+	std::cout << std::endl;
+}
+
+/**
+ * every rank query against a walk of the list.
+ */
+bool consistent(const map_type &map) {
+	size_t k = 0;
+	for (map_type::const_iterator it = map.cbegin(); it != map.cend(); ++it, ++k) {
+		if (map.nth(k) != it || map.position_of(it) != k) return false;
+	}
+	return map.position_of(map.cend()) == map.size();
+}
+
+int main() {
+	{
+		map_type map;
+		for (int i = 0; i < 10; ++i) map[i] = i * i;
+		std::cout << map.nth(0)->first << " " << map.nth(9)->first << " " << map.position_of(map.find(4)) << std::endl;
+
+		map.erase(3);
+		map.touch(map.find(0));
+		map.move_to_front(map.find(7));
+		print("map", map);
+		std::cout << map.nth(3)->first << " " << map.position_of(map.find(0)) << " " << consistent(map) << std::endl;
+
+		map_type::iterator it = map.find(5);
+		std::cout << map.advance(it, 3)->first << " " << map.advance(it, -4)->first
+			<< " " << (map.advance(it, 5) == map.end()) << " " << (map.advance(map.end(), -9) == map.begin()) << std::endl;
+		try {
+			map.advance(it, 6);
+		} catch (sjtu::index_out_of_bound &) {
+			std::cout << "past end" << std::endl;
+		}
+		try {
+			map.advance(it, -5);
+		} catch (sjtu::index_out_of_bound &) {
+			std::cout << "before begin" << std::endl;
+		}
+		try {
+			map.nth(map.size());
+		} catch (sjtu::index_out_of_bound &) {
+			std::cout << "nth out of range" << std::endl;
+		}
+
+		map_type other = map.sibling();
+		other.insert(map.extract(6));
+		for (int i = 100; i < 104; ++i) other[i] = i;
+		map.splice(map.nth(2), other, other.find(101), other.cend());
+		print("map", map);
+		print("other", other);
+		std::cout << map.position_of(map.find(102)) << " " << consistent(map) << " " << consistent(other) << std::endl;
+		try {
+			map.position_of(other.cbegin());
+		} catch (sjtu::invalid_iterator &) {
+			std::cout << "foreign iterator" << std::endl;
+		}
+
+		map_type copy(map);
+		map.clear();
+		std::cout << map.empty() << " " << consistent(map) << " " << copy.nth(4)->first << " " << consistent(copy) << std::endl;
+		map.swap(copy);
+		std::cout << map.nth(map.size() - 1)->first << " " << consistent(map) << " " << consistent(copy) << std::endl;
+	}
+	{
+		// random changes, checked against a vector of the keys in order.
+		map_type map;
+		map.set_capacity(500);
+		std::vector<int> model;
+		unsigned long long state = 0x9e3779b97f4a7c15ULL;
+		auto next = [&]() {
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			return state;
+		};
+		bool ok = true;
+		for (int step = 0; step < 20000; ++step) {
+			int key = static_cast<int>(next() % 700);
+			std::vector<int>::iterator pos = std::find(model.begin(), model.end(), key);
+			switch (next() % 5) {
+			case 0:
+			case 1:
+				if (pos == model.end()) {
+					map[key] = step;
+					model.push_back(key);
+					if (model.size() > 500) model.erase(model.begin());
+				}
+				break;
+			case 2:
+				if (pos != model.end()) model.erase(pos);
+				map.erase(key);
+				break;
+			case 3:
+				if (pos != model.end()) {
+					model.erase(pos);
+					model.push_back(key);
+					map.touch(map.find(key));
+				}
+				break;
+			default:
+				if (pos != model.end()) {
+					model.erase(pos);
+					model.insert(model.begin(), key);
+					map.move_to_front(map.find(key));
+				}
+				break;
+			}
+			if (!model.empty()) {
+				size_t k = next() % model.size();
+				if (map.nth(k)->first != model[k] || map.position_of(map.find(model[k])) != k) ok = false;
+				std::ptrdiff_t n = static_cast<std::ptrdiff_t>(next() % (model.size() + 1)) - static_cast<std::ptrdiff_t>(k);
+				map_type::iterator moved = map.advance(map.nth(k), n);
+				if (k + n == model.size() ? moved != map.end() : moved->first != model[k + n]) ok = false;
+			}
+			if (step % 4000 == 0 && !consistent(map)) ok = false;
+		}
+		std::cout << map.size() << " " << model.size() << " " << ok << " " << consistent(map) << std::endl;
+	}
+	return 0;
+}
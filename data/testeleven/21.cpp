@@ -0,0 +1,79 @@
+#include "parallel_linked_hashmap.hpp"
+#include "compact_linked_hashmap.hpp"
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <vector>
+
+typedef sjtu::linked_hashmap<int, long long> Map;
+typedef sjtu::compact_linked_hashmap<int, long long> CompactMap;
+typedef sjtu::linked_hashmap<int, long long, std::hash<int>, std::equal_to<int>,
+	sjtu::pool_allocator<sjtu::pair<const int, long long> >, sjtu::pow2_mix_bucket, sjtu::swiss_index> SwissMap;
+typedef sjtu::linked_hashmap<int, long long, std::hash<int>, std::equal_to<int>,
+	sjtu::pool_allocator<sjtu::pair<const int, long long> >, sjtu::pow2_mix_bucket, sjtu::incremental_index> IncrementalMap;
+
+template<class M>
+void fill(M &map, int n) {
+	for (int i = 0; i < n; ++i) map[i * 7 % n] = i;
+	for (int i = 0; i < n; i += 3) map.erase(map.find(i));
+}
+
+template<class M>
+void scan(const char *name, M &map, size_t threads) {
+	std::atomic<long long> sum(0), count(0);
+	sjtu::parallel_for_each(map, [&](sjtu::pair<const int, long long> &element) {
+		element.second *= 2;
+	}, threads);
+	const M &view = map;
+	sjtu::parallel_for_each(view, [&](const sjtu::pair<const int, long long> &element) {
+		sum += element.second;
+		++count;
+	}, threads);
+	long long serial = 0;
+	for (typename M::const_iterator it = view.cbegin(); it != view.cend(); ++it) serial += it->second;
+	std::cout << name << " " << threads << " " << count << " " << sum << " " << (sum == serial) << std::endl;
+}
+
+int main() {
+	Map map;
+	fill(map, 100000);
+	CompactMap compact;
+	fill(compact, 100000);
+	scan("linked", map, 4);
+	scan("linked", map, 1);
+	scan("compact", compact, 3);
+	SwissMap swiss;
+	fill(swiss, 100000);
+	scan("swiss", swiss, 4);
+	// while it migrates, the slices cover both bucket arrays.
+	IncrementalMap incremental;
+	fill(incremental, 70001);
+	scan("incremental", incremental, 4);
+	Map tiny;
+	scan("tiny", tiny, 4);
+	tiny[5] = 1;
+	scan("tiny", tiny, 4);
+
+	std::vector<sjtu::pair<const int, long long> > values;
+	for (int i = 0; i < 200000; ++i) values.push_back(sjtu::pair<const int, long long>(i * 31 % 150000, i));
+	Map built, expected;
+	built[-1] = -1;
+	expected[-1] = -1;
+	size_t inserted = sjtu::build_from(built, values.data(), values.size(), 4);
+	for (size_t i = 0; i < values.size(); ++i) expected.insert(values[i]);
+	bool same = built.size() == expected.size();
+	Map::const_iterator a = built.cbegin(), b = expected.cbegin();
+	for (; same && a != built.cend(); ++a, ++b) {
+		if (a->first != b->first || a->second != b->second) same = false;
+	}
+	std::cout << inserted << " " << built.size() << " " << same << " " << built.at(149999) << std::endl;
+
+	try {
+		sjtu::parallel_for_each(map, [](sjtu::pair<const int, long long> &element) {
+			if (element.first == 77777) throw sjtu::runtime_error();
+		}, 4);
+	} catch (sjtu::runtime_error &) {
+		std::cout << "rethrown" << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,143 @@
+#include "linked_hashmap_hardened.hpp"
+#include "linked_hashmap_stats.hpp"
+#include <cctype>
+#include <iostream>
+#include <string>
+
+struct ConstantHash {
+	template<class K>
+	size_t operator () (const K &) const {
+		return 42;
+	}
+};
+
+struct SmallHash {
+	size_t operator () (int x) const {
+		return x % 8;
+	}
+};
+
+/**
+ * a key without operator<.
+ */
+struct Name {
+	std::string text;
+};
+
+struct NameEqual {
+	bool operator () (const Name &lhs, const Name &rhs) const {
+		return lhs.text == rhs.text;
+	}
+};
+
+/**
+ * equal ignoring case, which operator< of std::string does not.
+ */
+struct CaseEqual {
+	bool operator () (const std::string &lhs, const std::string &rhs) const {
+		if (lhs.size() != rhs.size()) return false;
+		for (size_t i = 0; i < lhs.size(); ++i) {
+			if (std::tolower(static_cast<unsigned char>(lhs[i])) != std::tolower(static_cast<unsigned char>(rhs[i]))) return false;
+		}
+		return true;
+	}
+};
+
+template<class Hash, class Index>
+using int_map = sjtu::linked_hashmap<int, int, Hash, std::equal_to<int>,
+	sjtu::pool_allocator<sjtu::pair<const int, int> >, sjtu::seeded_mix_bucket, Index>;
+
+template<class Map>
+bool check(const Map &map, int n, int step, bool thirds_erased = true) {
+	int expected = 0;
+	for (typename Map::const_iterator it = map.cbegin(); it != map.cend(); ++it, expected += step) {
+		while (thirds_erased && expected % 3 == 0 && expected < n) expected += step;
+		if (it->first != expected || it->second != -expected) return false;
+	}
+	return true;
+}
+
+template<class Hash, class Index>
+void flood(const char *name, int n) {
+	int_map<Hash, sjtu::stats_index<Index> > map;
+	for (int i = 0; i < n; ++i) map[i] = -i;
+	for (int i = 0; i < n; i += 3) map.erase(i);
+	map.reset_stats();
+	int found = 0;
+	for (int i = 0; i < n; ++i) found += map.count(i);
+	sjtu::index_stats stats = map.stats();
+	std::cout << name << ": " << found << " " << check(map, n, 1)
+		<< " probes/lookup " << (stats.mean_probes() < 3 ? "log" : "linear")
+		<< " max probes " << (stats.max_probes <= 1 ? "1" : "many") << std::endl;
+}
+
+int main() {
+	{
+		int_map<std::hash<int>, sjtu::chained_index> a, b;
+		for (int i = 0; i < 1000; ++i) {
+			a[i] = -i;
+			b[i] = -i;
+		}
+		std::cout << "seeds differ " << (a.hash_code(7) != b.hash_code(7)) << std::endl;
+		int_map<std::hash<int>, sjtu::chained_index> copy(a);
+		int_map<std::hash<int>, sjtu::chained_index> assigned;
+		assigned[5000] = 1;
+		assigned = b;
+		int found = 0;
+		for (int i = 0; i < 1000; ++i) found += copy.count(i) + assigned.count(i);
+		std::cout << "copies " << (copy.hash_code(7) == a.hash_code(7)) << " "
+			<< (assigned.hash_code(7) == b.hash_code(7)) << " " << found << " " << assigned.count(5000) << std::endl;
+		copy.insert(sjtu::pair<const int, int>(2000, 1));
+		swap(copy, b);
+		std::cout << "swapped " << b.count(2000) << " " << copy.count(2000) << " " << b.at(999) << std::endl;
+	}
+
+	flood<ConstantHash, sjtu::chained_index>("constant chained", 3000);
+	flood<ConstantHash, sjtu::treeified_index>("constant treeified", 3000);
+	flood<SmallHash, sjtu::treeified_index>("small treeified", 3000);
+	flood<std::hash<int>, sjtu::treeified_index>("good treeified", 3000);
+
+	{
+		int_map<ConstantHash, sjtu::treeified_index> map;
+		for (int i = 0; i < 20000; i += 2) map[i] = -i;
+		for (int i = 0; i < 20000; i += 2) {
+			if (i % 3 == 0) map.erase(i);
+		}
+		std::cout << "run " << map.size() << " " << check(map, 20000, 2) << std::endl;
+		for (int i = 0; i < 20000; i += 2) {
+			if (i % 3 != 0 && i > 10) map.erase(i);
+		}
+		std::cout << "shrunk " << map.size() << " " << map.count(2) << map.count(4) << map.count(8) << map.count(10)
+			<< map.count(12) << map.count(14) << std::endl;
+		map.rehash(0);
+		map.clear();
+		for (int i = 0; i < 100; ++i) map[i] = -i;
+		int_map<ConstantHash, sjtu::treeified_index> copy(map);
+		std::cout << "copy " << copy.size() << " " << check(copy, 100, 1, false) << " " << copy.at(99) << std::endl;
+	}
+	{
+		sjtu::linked_hashmap<Name, int, ConstantHash, NameEqual,
+			sjtu::pool_allocator<sjtu::pair<const Name, int> >, sjtu::seeded_mix_bucket, sjtu::treeified_index> names;
+		for (int i = 0; i < 500; ++i) names[Name{std::to_string(i)}] = i;
+		for (int i = 0; i < 500; i += 2) names.erase(Name{std::to_string(i)});
+		long long sum = 0;
+		for (int i = 0; i < 500; ++i) {
+			if (names.count(Name{std::to_string(i)})) sum += names.at(Name{std::to_string(i)});
+		}
+		int first = names.begin()->second;
+		std::cout << "unordered keys " << names.size() << " " << sum << " " << first << std::endl;
+	}
+	{
+		sjtu::linked_hashmap<std::string, int, ConstantHash, CaseEqual,
+			sjtu::pool_allocator<sjtu::pair<const std::string, int> >, sjtu::seeded_mix_bucket, sjtu::treeified_index> words;
+		for (int i = 0; i < 10; ++i) words[std::string(1, static_cast<char>('a' + i)) + "x"] = i;
+		words["ABC"] = 10;
+		words["abc"] += 1;
+		words["Bx"] += 100;
+		std::cout << "case-insensitive " << words.size() << " " << words.at("aBc") << " " << words.at("bX")
+			<< " " << words.count("ab") << std::endl;
+		for (int i = 0; i < 10; i += 2) words.erase(std::string(1, static_cast<char>('A' + i)) + "X");
+		std::cout << words.size() << " " << words.count("ax") << words.count("bx") << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,87 @@
+#include "linked_hashmap_stats.hpp"
+#include <iostream>
+
+struct GoodHash {
+	size_t operator () (int x) const {
+		return std::hash<int>()(x);
+	}
+};
+
+struct BadHash {
+	size_t operator () (int x) const {
+		return x % 8;
+	}
+};
+
+template<class Map, class = void>
+struct has_stats {
+	static const bool value = false;
+};
+
+template<class Map>
+struct has_stats<Map, typename sjtu::void_type<decltype(std::declval<const Map &>().stats())>::type> {
+	static const bool value = true;
+};
+
+template<class Hash, class Index>
+void run(const char *name) {
+	typedef sjtu::linked_hashmap<int, int, Hash, std::equal_to<int>,
+		sjtu::pool_allocator<sjtu::pair<const int, int> >, sjtu::pow2_mix_bucket, sjtu::stats_index<Index> > map_type;
+	map_type map;
+	for (int i = 0; i < 4000; ++i) map[i] = i;
+	for (int i = 0; i < 4000; i += 2) map.erase(i);
+	map.reset_stats();
+
+	long long sum = 0;
+	for (int i = 0; i < 8000; ++i) sum += map.count(i);
+	sjtu::index_stats stats = map.stats();
+	std::cout << name << ": " << sum << " lookups " << stats.lookups << " hits " << stats.hits
+		<< " misses " << stats.misses() << " ratio " << stats.hit_ratio() << std::endl;
+	std::cout << "  probes/lookup " << (stats.mean_probes() < 2 ? "low" : "high")
+		<< " max chain " << (stats.max_chain < 64 ? "short" : "long")
+		<< " used buckets " << (stats.used_buckets <= 8 ? "few" : "many") << std::endl;
+
+	std::vector<size_t> histogram = map.bucket_histogram();
+	size_t buckets = 0, entries = 0;
+	for (size_t k = 0; k < histogram.size(); ++k) {
+		buckets += histogram[k];
+		entries += k * histogram[k];
+	}
+	std::cout << "  histogram " << (buckets == stats.buckets) << " " << entries << std::endl;
+}
+
+template<class Index>
+void growth(const char *name) {
+	typedef sjtu::linked_hashmap<int, int, GoodHash, std::equal_to<int>,
+		sjtu::pool_allocator<sjtu::pair<const int, int> >, sjtu::pow2_mix_bucket, sjtu::stats_index<Index> > map_type;
+	map_type map;
+	for (int i = 0; i < 1000; ++i) map[i] = i;
+	sjtu::index_stats grown = map.stats();
+	map.reserve(100000);
+	map.erase(5);
+	sjtu::index_stats reserved = map.stats();
+	std::cout << name << ": inserts " << grown.inserts << " grew " << (grown.rehashes > 3)
+		<< " reserve rehashes " << reserved.rehashes - grown.rehashes << " erases " << reserved.erases
+		<< " time " << (reserved.rehash_seconds >= 0) << std::endl;
+
+	map_type copy(map);
+	std::cout << "  copy " << copy.stats().inserts << " " << copy.stats().lookups << std::endl;
+	copy.swap(map);
+	std::cout << "  swap " << map.stats().inserts << " " << copy.stats().inserts << std::endl;
+}
+
+int main() {
+	std::cout << has_stats<sjtu::linked_hashmap<int, int> >::value << " "
+		<< has_stats<sjtu::linked_hashmap<int, int, GoodHash, std::equal_to<int>,
+			sjtu::pool_allocator<sjtu::pair<const int, int> >, sjtu::pow2_mix_bucket, sjtu::stats_index<> > >::value << std::endl;
+	run<GoodHash, sjtu::chained_index>("good chained");
+	run<BadHash, sjtu::chained_index>("bad chained");
+	run<GoodHash, sjtu::incremental_index>("good incremental");
+	run<BadHash, sjtu::incremental_index>("bad incremental");
+	run<GoodHash, sjtu::swiss_index>("good swiss");
+	run<BadHash, sjtu::swiss_index>("bad swiss");
+	growth<sjtu::chained_index>("chained");
+	growth<sjtu::incremental_index>("incremental");
+	growth<sjtu::swiss_index>("swiss");
+	return 0;
+}
@@ -0,0 +1,92 @@
+#include "concurrent_linked_hashmap.hpp"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+const int THREADS = 4;
+const int PER_THREAD = 20000;
+
+typedef sjtu::concurrent_linked_hashmap<int, long long> Map;
+
+void writer(Map &map, int id) {
+	for (int i = 0; i < PER_THREAD; ++i) {
+		int key = i * THREADS + id;
+		map.insert(key, key * 3LL);
+		if (i % 4 == 0) map.erase(key);
+		if (i % 4 == 1) map.insert_or_assign(key, key * 5LL);
+		if (i % 4 == 2) map.update(key, [](long long &value) { value += 1; });
+	}
+}
+
+void reader(const Map &map, long long &sum, int &hit) {
+	for (int round = 0; round < 3; ++round) {
+		for (int key = 0; key < THREADS * PER_THREAD; key += 7) {
+			long long value;
+			if (map.find(key, value)) {
+				++hit;
+				if (value != key * 3LL && value != key * 5LL && value != key * 3LL + 1) {
+					std::cout << "torn " << key << std::endl;
+				}
+				sum += value % 2;
+			}
+		}
+	}
+}
+
+int main() {
+	Map map(16);
+	std::vector<std::thread> threads;
+	long long sums[2] = {0, 0};
+	int hits[2] = {0, 0};
+	for (int i = 0; i < THREADS; ++i) threads.push_back(std::thread(writer, std::ref(map), i));
+	for (int i = 0; i < 2; ++i) threads.push_back(std::thread(reader, std::cref(map), std::ref(sums[i]), std::ref(hits[i])));
+	for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+
+	std::cout << map.size() << " " << map.shards_used() << std::endl;
+	long long total = 0;
+	int ok = 0;
+	for (int key = 0; key < THREADS * PER_THREAD; ++key) {
+		long long value;
+		bool present = map.find(key, value);
+		int step = key / THREADS % 4;
+		if (present != (step != 0)) continue;
+		if (step == 1 && value != key * 5LL) continue;
+		if (step == 2 && value != key * 3LL + 1) continue;
+		if (step == 3 && value != key * 3LL) continue;
+		++ok;
+		if (present) total += value;
+	}
+	std::cout << ok << " " << total << std::endl;
+
+	// every thread inserted its own keys in increasing order,
+	//   and the global order must keep each of those sequences.
+	int last[THREADS];
+	for (int i = 0; i < THREADS; ++i) last[i] = -1;
+	int ordered = 0, visited = 0;
+	map.for_each([&](const int &key, const long long &) {
+		++visited;
+		if (key > last[key % THREADS]) ++ordered;
+		last[key % THREADS] = key;
+	});
+	std::cout << visited << " " << ordered << std::endl;
+
+	sjtu::linked_hashmap<int, long long> copy = map.snapshot();
+	long long copy_sum = 0;
+	for (auto it = copy.begin(); it != copy.end(); ++it) copy_sum += it->second;
+	std::cout << copy.size() << " " << copy_sum << std::endl;
+
+	Map single(1);
+	single.try_emplace(1, 10);
+	single.try_emplace(2, 20);
+	single.try_emplace(1, 30);
+	std::string seen;
+	single.for_each([&](const int &key, const long long &value) {
+		seen += std::to_string(key) + ":" + std::to_string(value) + " ";
+	});
+	std::cout << seen << single.count(2) << " " << single.erase(2) << " " << single.count(2) << std::endl;
+
+	map.clear();
+	std::cout << map.size() << " " << map.empty() << std::endl;
+	return 0;
+}
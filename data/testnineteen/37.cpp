@@ -0,0 +1,68 @@
+#include "linked_hashmap.hpp"
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+typedef sjtu::linked_hashmap<int, std::string> map_type;
+
+static_assert(std::is_same<std::iterator_traits<map_type::iterator>::iterator_category,
+	std::bidirectional_iterator_tag>::value, "iterator is bidirectional");
+static_assert(std::is_same<std::iterator_traits<map_type::const_iterator>::reference,
+	const map_type::value_type &>::value, "const_iterator yields const references");
+
+int sum_keys(const map_type &map) {
+	int sum = 0;
+	for (const map_type::value_type &value : map) sum += value.first;
+	return sum;
+}
+
+int main() {
+	map_type map;
+	for (int i = 0; i < 8; ++i) map[i * 3 % 8] = std::to_string(i);
+	const map_type &view = map;
+
+	std::cout << sum_keys(map) << " " << std::distance(view.begin(), view.end()) << std::endl;
+	for (map_type::const_reverse_iterator it = view.rbegin(); it != view.rend(); ++it) std::cout << it->first << " ";
+	std::cout << std::endl;
+	for (map_type::reverse_iterator it = map.rbegin(); it != map.rend(); ++it) it->second += "!";
+	std::cout << map.begin()->second << " " << std::prev(map.end())->second << std::endl;
+
+	std::vector<int> keys;
+	std::transform(map.crbegin(), map.crend(), std::back_inserter(keys),
+		[](const map_type::value_type &value) { return value.first; });
+	std::reverse(keys.begin(), keys.end());
+	std::cout << std::equal(keys.begin(), keys.end(), view.begin(),
+		[](int key, const map_type::value_type &value) { return key == value.first; }) << std::endl;
+	map_type::const_iterator found = std::find_if(view.begin(), view.end(),
+		[](const map_type::value_type &value) { return value.second == "5!"; });
+	std::cout << found->first << " " << std::distance(found, view.end()) << std::endl;
+
+	map.touch(map.find(0));
+	std::cout << map.rbegin()->first << " " << (map.rend().base() == map.begin()) << std::endl;
+
+	map_type empty;
+	const map_type &empty_view = empty;
+	std::cout << (empty_view.rbegin() == empty_view.rend()) << " " << sum_keys(empty) << std::endl;
+	int thrown = 0;
+	try {
+		++empty_view.end();
+	} catch (sjtu::invalid_iterator &) {
+		++thrown;
+	}
+	try {
+		--map.begin();
+	} catch (sjtu::invalid_iterator &) {
+		++thrown;
+	}
+	try {
+		map_type::iterator none;
+		none++;
+	} catch (sjtu::invalid_iterator &) {
+		++thrown;
+	}
+	std::cout << map_type::checked_iterators << " " << thrown << std::endl;
+	return 0;
+}
@@ -0,0 +1,186 @@
+#include "linked_hashmap.hpp"
+#include "compact_linked_hashmap.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+class Integer {
+public:
+	static int counter;
+	int val;
+	
+	Integer(int val) : val(val) {
+		counter++;
+	}
+
+	Integer(const Integer &rhs) {
+		val = rhs.val;
+		counter++;
+	}
+
+	Integer& operator = (const Integer &rhs) {
+		assert(false);
+	}
+
+	~Integer() {
+		counter--;
+	}
+};
+
+int Integer::counter = 0;
+
+class Equal {
+public:
+	bool operator () (const Integer &lhs, const Integer &rhs) const {
+		return lhs.val == rhs.val;
+	}
+};
+class Hash {
+public:
+	unsigned int operator () (const Integer &lhs) const {
+		return std::hash<int>()(lhs.val);
+	}
+};
+class BadHash {
+public:
+	unsigned int operator () (const Integer &lhs) const {
+		return lhs.val % 5;
+	}
+};
+const int mod = 100003;
+int cur = 7, factor = 48271;
+inline int getNum() {
+	cur = 1ll * cur * factor % 2147483647;
+	return cur % 200000;
+}
+template<class Map>
+void tester(const char *name, int n) {
+	cur = 7;
+	Map map;
+	map.reserve(n / 2);
+	long long sum = 0;
+	for (int i = 0; i < n; ++i) {
+		int x = getNum();
+		if (map.count(Integer(x))) {
+			sum += map.at(Integer(x));
+			map.erase(map.find(Integer(x)));
+		} else {
+			map[Integer(x)] = i;
+		}
+	}
+	Map copy(map);
+	for (int i = 0; i < n / 2; ++i) {
+		int x = getNum();
+		if (copy.find(Integer(x)) != copy.end()) {
+			copy.erase(copy.find(Integer(x)));
+		} else {
+			copy.insert(typename Map::value_type(Integer(x), -i));
+		}
+	}
+	copy.shrink_to_fit();
+	long long order = 0;
+	for (typename Map::const_iterator it = copy.cbegin(); it != copy.cend(); ++it) {
+		order = (order * 31 + it->first.val) % mod;
+	}
+	std::cout << name << " " << map.size() << " " << copy.size() << " " << sum << " " << order << std::endl;
+	map.clear();
+	copy = map;
+	assert(copy.empty());
+}
+
+typedef sjtu::pool_allocator<sjtu::pair<const Integer, int> > Alloc;
+
+/**
+ * a hash seeded afresh for every map, as a randomized hash would be.
+ */
+class SeededHash {
+public:
+	static unsigned next_seed;
+	unsigned seed;
+
+	SeededHash() : seed(next_seed++ * 2654435761u) {}
+
+	unsigned int operator () (const Integer &lhs) const {
+		return std::hash<int>()(lhs.val) ^ seed;
+	}
+};
+
+unsigned SeededHash::next_seed = 1;
+
+/**
+ * a value whose copies start throwing after budget of them.
+ */
+class Fragile {
+public:
+	static int budget;
+	Integer val;
+
+	Fragile(int val) : val(val) {}
+
+	Fragile(const Fragile &rhs) : val(rhs.val) {
+		if (budget >= 0 && budget-- == 0) throw 1;
+	}
+
+	Fragile& operator = (const Fragile &) = delete;
+};
+
+int Fragile::budget = -1;
+
+void compact_semantics() {
+	typedef sjtu::compact_linked_hashmap<Integer, int, SeededHash, Equal> Map;
+	Map first;
+	for (int i = 0; i < 100; ++i) first[Integer(i)] = i;
+	{
+		// the assigned map must hash with the seed of first, whose hashes it copied.
+		Map assigned;
+		assigned[Integer(-1)] = -1;
+		assigned = first;
+		assigned[Integer(100)] = 100;
+		std::cout << assigned.count(Integer(42)) << " " << assigned.at(Integer(99)) << " "
+			<< assigned.size() << " " << assigned.count(Integer(-1)) << std::endl;
+	}
+	{
+		Map moved(std::move(first));
+		std::cout << moved.size() << " " << first.size() << " " << first.count(Integer(1)) << std::endl;
+		first[Integer(7)] = 70;
+		Map target;
+		target[Integer(3)] = 3;
+		target = std::move(moved);
+		std::cout << target.size() << " " << target.cbegin()->first.val << " " << moved.size() << std::endl;
+		swap(target, first);
+		std::cout << target.size() << " " << target.at(Integer(7)) << " " << first.size() << " " << first.count(Integer(50)) << std::endl;
+	}
+	{
+		sjtu::compact_linked_hashmap<int, Fragile> source, dest;
+		for (int i = 0; i < 50; ++i) source.insert(sjtu::compact_linked_hashmap<int, Fragile>::value_type(i, Fragile(i)));
+		dest.insert(sjtu::compact_linked_hashmap<int, Fragile>::value_type(-1, Fragile(-1)));
+		int thrown = 0;
+		Fragile::budget = 20;
+		try {
+			sjtu::compact_linked_hashmap<int, Fragile> copy(source);
+		} catch (int) {
+			++thrown;
+		}
+		Fragile::budget = 20;
+		try {
+			dest = source;
+		} catch (int) {
+			++thrown;
+		}
+		Fragile::budget = -1;
+		std::cout << thrown << " " << dest.size() << " " << dest.count(-1) << std::endl;
+	}
+}
+
+int main(void) {
+	tester<sjtu::linked_hashmap<Integer, int, Hash, Equal> >("chained/pow2", 300000);
+	tester<sjtu::linked_hashmap<Integer, int, Hash, Equal, Alloc, sjtu::prime_mod_bucket> >("chained/prime", 300000);
+	tester<sjtu::linked_hashmap<Integer, int, Hash, Equal, Alloc, sjtu::pow2_mix_bucket, sjtu::swiss_index> >("swiss/pow2", 300000);
+	tester<sjtu::linked_hashmap<Integer, int, Hash, Equal, Alloc, sjtu::pow2_mix_bucket, sjtu::incremental_index> >("incremental/pow2", 300000);
+	tester<sjtu::compact_linked_hashmap<Integer, int, Hash, Equal> >("compact/pow2", 300000);
+	tester<sjtu::linked_hashmap<Integer, int, BadHash, Equal> >("chained/bad", 3000);
+	tester<sjtu::linked_hashmap<Integer, int, BadHash, Equal, Alloc, sjtu::pow2_mix_bucket, sjtu::swiss_index> >("swiss/bad", 3000);
+	tester<sjtu::linked_hashmap<Integer, int, BadHash, Equal, Alloc, sjtu::prime_mod_bucket, sjtu::incremental_index> >("incremental/bad", 3000);
+	tester<sjtu::compact_linked_hashmap<Integer, int, BadHash, Equal> >("compact/bad", 3000);
+	compact_semantics();
+	std::cout << Integer::counter << std::endl;
+}
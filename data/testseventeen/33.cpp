@@ -0,0 +1,134 @@
+#include "linked_hashmap.hpp"
+#include "linked_hashmap_hardened.hpp"
+#include <iostream>
+#include <memory>
+#include <string>
+
+class Tracked {
+public:
+	static int copies;
+	int val;
+
+	explicit Tracked(int val) : val(val) {}
+	Tracked(const Tracked &other) : val(other.val) {
+		++copies;
+	}
+	Tracked(Tracked &&other) noexcept : val(other.val) {}
+};
+
+int Tracked::copies = 0;
+
+typedef sjtu::linked_hashmap<int, Tracked> map_type;
+
+template<class Map>
+void print(const char *name, const Map &map) {
+	std::cout << name << " " << map.size() << ":";
+	for (typename Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) std::cout << " " << it->first;
+	std::cout << std::endl;
+}
+
+int main() {
+	{
+		map_type a;
+		for (int i = 0; i < 10; ++i) a.try_emplace(i, i * 10);
+		map_type b = a.sibling();
+		const Tracked *address = &a.find(3)->second;
+		map_type::node_type handle = a.extract(a.find(3));
+		std::cout << handle.empty() << " " << handle.key() << " " << handle.mapped().val << " " << a.count(3) << std::endl;
+		map_type::insert_return_type result = b.insert(std::move(handle));
+		std::cout << result.inserted << " " << result.position->first << " " << (&result.position->second == address)
+			<< " " << handle.empty() << std::endl;
+
+		b.try_emplace(5, -5);
+		map_type::insert_return_type again = b.insert(a.extract(5));
+		std::cout << again.inserted << " " << again.position->second.val << " " << again.node.key()
+			<< " " << again.node.mapped().val << std::endl;
+		a.insert(std::move(again.node));
+		std::cout << a.extract(42).empty() << " " << b.insert(map_type::node_type()).inserted << std::endl;
+		print("a", a);
+		print("b", b);
+
+		a.merge(b);
+		print("a", a);
+		print("b", b);
+		std::cout << "copies " << Tracked::copies << std::endl;
+
+		map_type::const_iterator first = a.find(1), last = a.find(6);
+		a.splice(a.cbegin(), a, first, last);
+		print("reordered", a);
+		try {
+			a.splice(a.find(2), a, a.find(1), a.find(4));
+		} catch (sjtu::invalid_iterator &) {
+			std::cout << "pos inside range" << std::endl;
+		}
+
+		map_type c = a.sibling();
+		c.try_emplace(0, 0);
+		c.try_emplace(100, 100);
+		c.splice(c.find(100), a, a.find(4), a.end());
+		print("c", c);
+		print("a", a);
+		c.splice(c.cbegin(), a, a.find(2));
+		c.splice(c.cend(), a);
+		print("c", c);
+		print("a", a);
+		try {
+			c.splice(c.cend(), a, c.cbegin(), c.cend());
+		} catch (sjtu::invalid_iterator &) {
+			std::cout << "foreign range" << std::endl;
+		}
+		std::cout << "copies " << Tracked::copies << std::endl;
+	}
+	{
+		map_type::node_type survivor;
+		{
+			map_type source;
+			source.try_emplace(7, 70);
+			survivor = source.extract(7);
+		}
+		map_type unrelated;
+		unrelated.try_emplace(1, 10);
+		map_type::insert_return_type result = unrelated.insert(std::move(survivor));
+		std::cout << "outlived " << result.inserted << " " << unrelated.at(7).val << " " << Tracked::copies << std::endl;
+
+		map_type other;
+		for (int i = 0; i < 1000; ++i) other.try_emplace(i, i);
+		unrelated.merge(std::move(other));
+		long long sum = 0;
+		for (map_type::const_iterator it = unrelated.cbegin(); it != unrelated.cend(); ++it) sum += it->second.val;
+		std::cout << "merged " << unrelated.size() << " " << other.size() << " " << sum << " " << unrelated.cbegin()->first << std::endl;
+	}
+	{
+		typedef sjtu::linked_hashmap<std::string, int, std::hash<std::string>, std::equal_to<std::string>,
+			std::allocator<sjtu::pair<const std::string, int> > > std_map;
+		std_map x, y;
+		for (int i = 0; i < 5; ++i) x[std::to_string(i)] = i;
+		y["9"] = 9;
+		const int *address = &x.at("2");
+		y.splice(y.cbegin(), x, x.find("1"), x.find("4"));
+		std::cout << "std allocator " << (&y.at("2") == address) << " " << x.size() << " " << y.size() << " " << y.cbegin()->first << std::endl;
+	}
+	{
+		typedef sjtu::linked_hashmap<int, int, std::hash<int>, std::equal_to<int>,
+			sjtu::pool_allocator<sjtu::pair<const int, int> >, sjtu::seeded_mix_bucket> seeded_map;
+		seeded_map p, q;
+		for (int i = 0; i < 3000; ++i) p[i] = i;
+		for (int i = 0; i < 3000; i += 2) q[i] = -i;
+		p.merge(q);
+		seeded_map r = p.sibling();
+		r.splice(r.cend(), p, p.find(1000), p.find(2000));
+		int found = 0;
+		for (int i = 0; i < 3000; ++i) found += p.count(i) * 2 + r.count(i);
+		std::cout << "seeded " << p.size() << " " << q.size() << " " << r.size() << " " << found << std::endl;
+	}
+	{
+		map_type lru;
+		lru.set_capacity(4);
+		for (int i = 0; i < 4; ++i) lru.try_emplace(i, i);
+		map_type extra = lru.sibling();
+		for (int i = 10; i < 13; ++i) extra.try_emplace(i, i);
+		lru.splice(lru.cend(), extra);
+		print("lru", lru);
+	}
+	return 0;
+}
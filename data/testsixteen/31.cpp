@@ -0,0 +1,98 @@
+#include "linked_hashmap.hpp"
+#include <iostream>
+#include <string>
+
+struct ConstantHash {
+	size_t operator () (int) const {
+		return 7;
+	}
+};
+
+typedef sjtu::linked_hashmap<int, std::string, std::hash<int>, std::equal_to<int>,
+	sjtu::pool_allocator<sjtu::pair<const int, std::string> >, sjtu::pow2_mix_bucket, sjtu::doubly_chained_index> map_type;
+
+typedef sjtu::linked_hashmap<int, int, ConstantHash, std::equal_to<int>,
+	sjtu::pool_allocator<sjtu::pair<const int, int> >, sjtu::pow2_mix_bucket, sjtu::doubly_chained_index> flat_map;
+
+template<class Map>
+void print(const Map &map) {
+	std::cout << map.size() << ":";
+	for (typename Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) std::cout << " " << it->first;
+	std::cout << std::endl;
+}
+
+int main() {
+	{
+		flat_map fifo;
+		long long expired = 0;
+		for (int i = 0; i < 40000; ++i) {
+			fifo[i] = i;
+			if (fifo.size() > 1000) {
+				expired += fifo.begin()->second;
+				fifo.erase(fifo.begin());
+			}
+		}
+		std::cout << "fifo " << fifo.size() << " " << expired << " " << fifo.begin()->first << " "
+			<< fifo.count(38999) << fifo.count(39000) << std::endl;
+		for (int i = 39999; i >= 39000; i -= 2) fifo.erase(i);
+		std::cout << "erased " << fifo.size() << " " << fifo.count(39001) << fifo.count(39002) << std::endl;
+	}
+	{
+		map_type map;
+		for (int i = 0; i < 10; ++i) map[i] = std::to_string(i);
+		map_type::iterator first = map.begin(), last = map.begin();
+		++first;
+		for (int i = 0; i < 4; ++i) ++last;
+		map_type::iterator after = map.erase(first, last);
+		std::cout << after->first << " ";
+		print(map);
+		map.erase(after, after);
+		print(map);
+		map_type::iterator tail = map.begin();
+		++tail;
+		std::cout << (map.erase(tail, map.end()) == map.end()) << " ";
+		print(map);
+
+		map_type other;
+		other[1] = "1";
+		try {
+			map.erase(other.begin(), map.end());
+		} catch (sjtu::invalid_iterator &) {
+			std::cout << "foreign range" << std::endl;
+		}
+		for (int i = 10; i < 15; ++i) map[i] = std::to_string(i);
+		map_type::iterator mid = map.find(12);
+		try {
+			map.erase(mid, map.find(11));
+		} catch (sjtu::invalid_iterator &) {
+			std::cout << "backward range ";
+			print(map);
+		}
+		map.erase(map.begin(), map.end());
+		print(map);
+	}
+	{
+		map_type a, b;
+		a.max_load_factor(100.0f);
+		for (int i = 0; i < 5; ++i) a[i] = std::to_string(i);
+		a.rehash(1);
+		std::cout << "single " << a.bucket_count() << std::endl;
+		b[42] = "42";
+		a.swap(b);
+		b.erase(b.find(0));
+		b.erase(4);
+		map_type c(std::move(b));
+		c.erase(2);
+		print(c);
+		b = std::move(c);
+		b.erase(b.find(1));
+		b.erase(3);
+		print(b);
+		a.erase(42);
+		print(a);
+		for (int i = 0; i < 100; ++i) b[i] = "x";
+		b.erase(b.begin(), b.find(90));
+		print(b);
+	}
+	return 0;
+}
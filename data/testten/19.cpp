@@ -0,0 +1,88 @@
+#include "rcu_linked_hashmap.hpp"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+const int READERS = 3;
+const int KEYS = 4000;
+const int ROUNDS = 6;
+
+typedef sjtu::rcu_linked_hashmap<int, std::string> Map;
+
+std::string value_of(int key, int round) {
+	return std::to_string(key) + "#" + std::to_string(round);
+}
+
+bool well_formed(int key, const std::string &value) {
+	std::string prefix = std::to_string(key) + "#";
+	return value.compare(0, prefix.size(), prefix) == 0 && value.size() > prefix.size();
+}
+
+std::atomic<bool> done(false);
+
+void reader(const Map &map, int &bad, long long &seen) {
+	while (!done.load()) {
+		for (int key = 0; key < KEYS; key += 13) {
+			Map::read_guard guard = map.pin();
+			const std::string *value = map.find(key, guard);
+			if (value && !well_formed(key, *value)) ++bad;
+		}
+		map.for_each([&](const int &key, const std::string &value) {
+			if (!well_formed(key, value)) ++bad;
+			++seen;
+		});
+	}
+}
+
+int main() {
+	Map map;
+	std::vector<std::thread> threads;
+	int bad[READERS] = {0};
+	long long seen[READERS] = {0};
+	for (int i = 0; i < READERS; ++i) threads.push_back(std::thread(reader, std::cref(map), std::ref(bad[i]), std::ref(seen[i])));
+
+	for (int round = 0; round < ROUNDS; ++round) {
+		for (int key = 0; key < KEYS; ++key) {
+			if ((key + round) % 3 == 0) {
+				map.erase(key);
+			} else {
+				map.insert_or_assign(key, value_of(key, round));
+			}
+		}
+	}
+	done.store(true);
+	for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+
+	int total_bad = 0;
+	for (int i = 0; i < READERS; ++i) total_bad += bad[i];
+	std::cout << total_bad << std::endl;
+
+	int correct = 0;
+	for (int key = 0; key < KEYS; ++key) {
+		std::string value;
+		bool present = map.find(key, value);
+		bool expected = (key + ROUNDS - 1) % 3 != 0;
+		if (present == expected && (!present || value == value_of(key, ROUNDS - 1))) ++correct;
+	}
+	std::cout << map.size() << " " << correct << std::endl;
+
+	// positions survive assignment: the order is that of the first insertion after the last erase
+	long long order_check = 0;
+	int index = 0;
+	map.for_each([&](const int &key, const std::string &) {
+		order_check += 1LL * key * (++index % 7);
+	});
+	std::cout << order_check << std::endl;
+
+	map.reclaim();
+	std::cout << map.pending_reclamation() << std::endl;
+
+	map.reserve(100000);
+	for (int key = KEYS; key < KEYS * 5; ++key) map.try_emplace(key, 3, 'x');
+	std::cout << map.size() << " " << map.count(KEYS * 2) << " " << map.count(-1) << std::endl;
+	map.clear();
+	map.reclaim();
+	std::cout << map.size() << " " << map.empty() << " " << map.pending_reclamation() << std::endl;
+	return 0;
+}
@@ -0,0 +1,241 @@
+#include "linked_hashmap_serialize.hpp"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <csignal>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+class Integer {
+public:
+	int val;
+	explicit Integer(int val) : val(val) {}
+};
+
+struct IntegerHash {
+	size_t operator () (const Integer &x) const {
+		return std::hash<int>()(x.val);
+	}
+};
+
+struct IntegerEqual {
+	bool operator () (const Integer &lhs, const Integer &rhs) const {
+		return lhs.val == rhs.val;
+	}
+};
+
+namespace sjtu {
+	template<>
+	struct codec<Integer> {
+		template<class Writer>
+		static void write(Writer &out, const Integer &value) {
+			write_varint(out, static_cast<unsigned int>(value.val));
+		}
+
+		template<class Reader>
+		static Integer read(Reader &in) {
+			return Integer(static_cast<int>(read_varint(in)));
+		}
+	};
+}
+
+struct string_sink {
+	std::string data;
+	size_t writes = 0;
+
+	void write(const void *bytes, size_t size) {
+		data.append(static_cast<const char *>(bytes), size);
+		++writes;
+	}
+};
+
+struct string_source {
+	const std::string &data;
+	size_t pos;
+
+	size_t read(void *bytes, size_t size) {
+		size_t step = data.size() - pos < size ? data.size() - pos : size;
+		data.copy(static_cast<char *>(bytes), step, pos);
+		pos += step;
+		return step;
+	}
+};
+
+template<class Map>
+bool same_order(const Map &lhs, const Map &rhs) {
+	if (lhs.size() != rhs.size()) return false;
+	typename Map::const_iterator it = rhs.cbegin();
+	for (typename Map::const_iterator jt = lhs.cbegin(); jt != lhs.cend(); ++jt, ++it) {
+		if (!(jt->first == it->first) || !(jt->second == it->second)) return false;
+	}
+	return true;
+}
+
+volatile sig_atomic_t alarms = 0;
+
+void on_alarm(int) {
+	alarms = alarms + 1;
+}
+
+int main() {
+	{
+		sjtu::linked_hashmap<std::string, int> map;
+		for (int i = 0; i < 20000; ++i) {
+			map[std::to_string(i * 7919 % 100003)] = i;
+		}
+		for (int i = 0; i < 20000; i += 3) {
+			map.erase(std::to_string(i * 7919 % 100003));
+		}
+		map.move_to_front(map.find(std::to_string(19999 * 7919 % 100003)));
+
+		std::FILE *file = std::tmpfile();
+		sjtu::file_sink sink(file);
+		sjtu::serialize(map, sink);
+		std::rewind(file);
+		sjtu::linked_hashmap<std::string, int> copy;
+		sjtu::file_source source(file);
+		size_t inserted = sjtu::deserialize(copy, source);
+		std::fclose(file);
+		std::cout << inserted << " " << copy.size() << " " << same_order(map, copy) << std::endl;
+		std::cout << copy.cbegin()->first << " " << copy.cbegin()->second << std::endl;
+	}
+	{
+		sjtu::linked_hashmap<Integer, std::string, IntegerHash, IntegerEqual> map;
+		for (int i = 0; i < 1000; ++i) {
+			map.try_emplace(Integer(i * 37 % 1009 - 500), std::string(i % 13, 'a' + i % 26));
+		}
+		map.try_emplace(Integer(5000), std::string(200000, 'z'));
+
+		string_sink sink;
+		sjtu::serialize(map, sink);
+		string_source source = {sink.data, 0};
+		sjtu::linked_hashmap<Integer, std::string, IntegerHash, IntegerEqual> copy;
+		copy.try_emplace(Integer(-500), "kept");
+		size_t inserted = sjtu::deserialize(copy, source);
+		std::cout << inserted << " " << copy.size() << " " << sink.writes << std::endl;
+		std::cout << copy.at(Integer(-500)) << " " << copy.at(Integer(5000)).size() << std::endl;
+		bool same = true;
+		auto it = map.cbegin();
+		for (auto jt = ++copy.cbegin(); jt != copy.cend(); ++jt) {
+			if ((++it)->first.val != jt->first.val || it->second != jt->second) same = false;
+		}
+		std::cout << same << std::endl;
+
+		std::string truncated = sink.data.substr(0, sink.data.size() / 2);
+		string_source short_source = {truncated, 0};
+		sjtu::linked_hashmap<Integer, std::string, IntegerHash, IntegerEqual> partial;
+		try {
+			sjtu::deserialize(partial, short_source);
+		} catch (sjtu::runtime_error &) {
+			std::cout << "truncated " << (partial.size() < map.size()) << std::endl;
+		}
+		std::string garbage = "not a map";
+		string_source bad_source = {garbage, 0};
+		try {
+			sjtu::deserialize(partial, bad_source);
+		} catch (sjtu::runtime_error &) {
+			std::cout << "bad magic" << std::endl;
+		}
+		// counts and lengths that no stream of this size can back.
+		std::string huge_count = std::string("SLH1") + "\xff\xff\xff\xff\xff\xff\xff\xff\x0f";
+		std::string huge_length = std::string("SLH1") + "\x01\x05" + "\xff\xff\xff\xff\xff\xff\xff\x3f" + "abc";
+		std::string overflow = std::string("SLH1") + "\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01";
+		std::string *hostile[] = {&huge_count, &huge_length, &overflow};
+		for (int i = 0; i < 3; ++i) {
+			string_source hostile_source = {*hostile[i], 0};
+			sjtu::linked_hashmap<Integer, std::string, IntegerHash, IntegerEqual> target;
+			target.try_emplace(Integer(1), "one");
+			try {
+				sjtu::deserialize(target, hostile_source);
+			} catch (sjtu::runtime_error &) {
+				std::cout << "hostile " << i << " " << target.size() << std::endl;
+			}
+		}
+	}
+	{
+		typedef sjtu::linked_hashmap<long long, double, std::hash<long long>, std::equal_to<long long>,
+			sjtu::pool_allocator<sjtu::pair<const long long, double> >, sjtu::pow2_mix_bucket, sjtu::incremental_index> incremental_map;
+		incremental_map map;
+		for (long long i = 0; i < 100000; ++i) {
+			map[i * 1000003] = i * 0.25;
+		}
+		string_sink sink;
+		sjtu::serialize(map, sink);
+
+		incremental_map expected;
+		expected.reserve(map.size());
+		incremental_map copy;
+		string_source source = {sink.data, 0};
+		sjtu::deserialize(copy, source);
+		std::cout << same_order(map, copy) << " " << (copy.bucket_count() == expected.bucket_count()) << std::endl;
+
+		int fds[2];
+		if (pipe(fds) == 0) {
+			sjtu::linked_hashmap<int, int> small;
+			for (int i = 0; i < 500; ++i) small[i * 31 % 500] = -i;
+			sjtu::fd_sink pipe_sink(fds[1]);
+			sjtu::serialize(small, pipe_sink);
+			close(fds[1]);
+			sjtu::fd_source pipe_source(fds[0]);
+			sjtu::linked_hashmap<int, int> received;
+			sjtu::deserialize(received, pipe_source);
+			close(fds[0]);
+			std::cout << same_order(small, received) << " " << received.cbegin()->first << std::endl;
+		}
+		if (pipe(fds) == 0) {
+			// two maps back to back on one stream, read through one reader.
+			sjtu::linked_hashmap<int, int> first, second;
+			for (int i = 0; i < 300; ++i) first[i] = i;
+			for (int i = 0; i < 200; ++i) second[-i] = i;
+			sjtu::fd_sink pipe_sink(fds[1]);
+			sjtu::serialize(first, pipe_sink);
+			sjtu::serialize(second, pipe_sink);
+			close(fds[1]);
+			sjtu::fd_source pipe_source(fds[0]);
+			sjtu::buffered_reader<sjtu::fd_source> reader(pipe_source);
+			sjtu::linked_hashmap<int, int> got_first, got_second;
+			sjtu::deserialize(got_first, reader);
+			sjtu::deserialize(got_second, reader);
+			close(fds[0]);
+			std::cout << same_order(first, got_first) << " " << same_order(second, got_second) << std::endl;
+		}
+		int back[2];
+		if (pipe(fds) == 0 && pipe(back) == 0) {
+			// a timer keeps interrupting the blocked read and write calls with EINTR.
+			sjtu::linked_hashmap<int, int> big;
+			for (int i = 0; i < 100000; ++i) big[i * 7 % 100000] = i;
+			pid_t child = fork();
+			if (child == 0) {
+				close(fds[1]);
+				close(back[0]);
+				usleep(50000);
+				sjtu::fd_source in(fds[0]);
+				sjtu::linked_hashmap<int, int> echoed;
+				sjtu::deserialize(echoed, in);
+				usleep(50000);
+				sjtu::fd_sink out(back[1]);
+				sjtu::serialize(echoed, out);
+				_exit(0);
+			}
+			close(fds[0]);
+			close(back[1]);
+			struct sigaction action = {};
+			action.sa_handler = on_alarm;
+			sigaction(SIGALRM, &action, nullptr);
+			struct itimerval every = {{0, 5000}, {0, 5000}};
+			setitimer(ITIMER_REAL, &every, nullptr);
+			sjtu::fd_sink out(fds[1]);
+			sjtu::serialize(big, out);
+			close(fds[1]);
+			sjtu::fd_source in(back[0]);
+			sjtu::linked_hashmap<int, int> returned;
+			sjtu::deserialize(returned, in);
+			struct itimerval off = {{0, 0}, {0, 0}};
+			setitimer(ITIMER_REAL, &off, nullptr);
+			close(back[0]);
+			waitpid(child, nullptr, 0);
+			std::cout << "interrupted " << (alarms > 0) << " " << same_order(big, returned) << std::endl;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,157 @@
+#include "linked_hashmap_snapshot.hpp"
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+struct Point {
+	int x, y;
+	double weight;
+};
+
+struct PointHash {
+	size_t operator () (const Point &p) const {
+		return std::hash<long long>()(1LL * p.x * 1000003 + p.y);
+	}
+};
+
+struct PointEqual {
+	bool operator () (const Point &lhs, const Point &rhs) const {
+		return lhs.x == rhs.x && lhs.y == rhs.y;
+	}
+};
+
+/**
+ * every default-constructed hasher gets a seed of its own.
+ */
+struct SeededHash {
+	static unsigned long long next;
+	unsigned long long seed;
+
+	SeededHash() : seed(++next * 0x9e3779b97f4a7c15ULL) {}
+
+	size_t operator () (int key) const {
+		return std::hash<int>()(key) ^ seed;
+	}
+};
+
+unsigned long long SeededHash::next = 0;
+
+/**
+ * rewrites the file at path with f applied to its bytes.
+ */
+template<class F>
+void patch(const char *path, F f) {
+	std::FILE *file = std::fopen(path, "rb");
+	std::string bytes;
+	char buffer[4096];
+	for (size_t got; (got = std::fread(buffer, 1, sizeof(buffer), file)) > 0; ) bytes.append(buffer, got);
+	std::fclose(file);
+	f(&bytes[0]);
+	file = std::fopen(path, "wb");
+	std::fwrite(bytes.data(), 1, bytes.size(), file);
+	std::fclose(file);
+}
+
+const char *PATH = "/tmp/sjtu_linked_hashmap_snapshot_test.bin";
+
+int main() {
+	sjtu::linked_hashmap<long long, Point> map;
+	for (long long i = 0; i < 50000; ++i) {
+		long long key = i * 2654435761LL % 1000003;
+		Point p = {int(i), int(-i), i * 0.5};
+		map.insert(sjtu::pair<const long long, Point>(key, p));
+	}
+	for (long long i = 0; i < 50000; i += 4) {
+		map.erase(i * 2654435761LL % 1000003);
+	}
+	sjtu::save_snapshot(map, PATH);
+
+	{
+		sjtu::mapped_linked_hashmap<long long, Point> view = sjtu::load_mmap<long long, Point>(PATH);
+		std::cout << view.size() << " " << map.size() << std::endl;
+		bool same = true;
+		sjtu::linked_hashmap<long long, Point>::const_iterator it = map.cbegin();
+		for (sjtu::mapped_linked_hashmap<long long, Point>::const_iterator v = view.cbegin(); v != view.cend(); ++v, ++it) {
+			if (v->first != it->first || v->second.x != it->second.x || v->second.weight != it->second.weight) same = false;
+		}
+		std::cout << same << std::endl;
+
+		int found = 0;
+		long long sum = 0;
+		for (long long i = 0; i < 60000; ++i) {
+			long long key = i * 2654435761LL % 1000003;
+			if (view.count(key)) {
+				++found;
+				sum += view.at(key).x;
+			}
+		}
+		std::cout << found << " " << sum << " " << (view.find(-5) == view.cend()) << std::endl;
+		try {
+			view.at(-5);
+		} catch (sjtu::index_out_of_bound &) {
+			std::cout << "missing" << std::endl;
+		}
+
+		sjtu::linked_hashmap<long long, Point> copy, prime_copy_source;
+		view.copy_to(copy);
+		sjtu::linked_hashmap<long long, Point, std::hash<long long>, std::equal_to<long long>,
+			sjtu::pool_allocator<sjtu::pair<const long long, Point> >, sjtu::prime_mod_bucket> prime_copy;
+		view.copy_to(prime_copy);
+		std::cout << copy.size() << " " << copy.at(2654435761LL % 1000003).y << " " << prime_copy.count(2654435761LL * 7 % 1000003) << std::endl;
+	}
+
+	sjtu::linked_hashmap<Point, int, PointHash, PointEqual> points;
+	for (int i = 0; i < 100; ++i) {
+		Point p = {i % 10, i / 10, 0};
+		points.insert(sjtu::pair<const Point, int>(p, i));
+	}
+	sjtu::save_snapshot(points, PATH);
+	sjtu::mapped_linked_hashmap<Point, int, PointHash, PointEqual> point_view = sjtu::load_mmap<Point, int, PointHash, PointEqual>(PATH);
+	Point probe = {3, 7, 0};
+	std::cout << point_view.size() << " " << point_view.at(probe) << " " << (--point_view.cend())->second << std::endl;
+
+	sjtu::linked_hashmap<int, int> empty;
+	sjtu::save_snapshot(empty, PATH);
+	std::cout << sjtu::load_mmap<int, int>(PATH).size() << std::endl;
+	try {
+		sjtu::load_mmap<long long, Point>(PATH);
+	} catch (sjtu::runtime_error &) {
+		std::cout << "rejected" << std::endl;
+	}
+
+	{
+		sjtu::linked_hashmap<int, int, SeededHash> seeded;
+		for (int i = 0; i < 1000; ++i) seeded[i] = -i;
+		sjtu::save_snapshot(seeded, PATH);
+		sjtu::mapped_linked_hashmap<int, int, SeededHash> view = sjtu::load_mmap<int, int, SeededHash>(PATH, seeded.hash_function());
+		int found = 0;
+		for (int i = 0; i < 1000; ++i) found += static_cast<int>(view.count(i));
+		std::cout << "seeded " << found << " " << view.at(999) << std::endl;
+	}
+	typedef sjtu::snapshot_detail::snapshot_header header_type;
+	typedef sjtu::snapshot_detail::entry<int, int> entry_type;
+	sjtu::linked_hashmap<int, int> small;
+	for (int i = 0; i < 10; ++i) small[i] = i;
+	const char *names[] = {"wrapping count", "chain out of range", "cyclic chain"};
+	for (int kind = 0; kind < 3; ++kind) {
+		sjtu::save_snapshot(small, PATH);
+		patch(PATH, [kind](char *bytes) {
+			header_type *header = reinterpret_cast<header_type *>(bytes);
+			entry_type *entries = reinterpret_cast<entry_type *>(bytes + header->entries_offset);
+			unsigned long long *buckets = reinterpret_cast<unsigned long long *>(bytes + header->buckets_offset);
+			if (kind == 0) header->count = 1ULL << 61;
+			for (unsigned long long i = 0; kind == 1 && i < header->bucket_count; ++i) buckets[i] = 1000;
+			for (unsigned long long i = 0; kind == 2 && i < header->count; ++i) entries[i].next = i;
+		});
+		try {
+			sjtu::mapped_linked_hashmap<int, int> view = sjtu::load_mmap<int, int>(PATH);
+			int found = 0;
+			for (int i = 0; i < 20; ++i) found += static_cast<int>(view.count(i));
+			std::cout << names[kind] << " missed " << found << std::endl;
+		} catch (sjtu::runtime_error &) {
+			std::cout << names[kind] << " rejected" << std::endl;
+		}
+	}
+	std::remove(PATH);
+	return 0;
+}
@@ -0,0 +1,59 @@
+// built with -fno-exceptions: every failure is reported by a try_ member.
+#include "linked_hashmap.hpp"
+#include "compact_linked_hashmap.hpp"
+#include <iostream>
+#include <string>
+
+class Hash {
+public:
+	size_t operator () (const std::string &key) const {
+		return std::hash<std::string>()(key);
+	}
+};
+
+typedef sjtu::linked_hashmap<std::string, int, Hash> map_type;
+typedef sjtu::linked_hashmap<int, int, std::hash<int>, std::equal_to<int>, sjtu::pool_allocator<sjtu::pair<const int, int> >,
+	sjtu::pow2_mix_bucket, sjtu::swiss_index, sjtu::ranked_order> ranked_map;
+
+int main() {
+#if defined(SJTU_NO_EXCEPTIONS)
+	std::cout << "no exceptions" << std::endl;
+#endif
+	map_type map;
+	for (int i = 0; i < 6; ++i) map[std::to_string(i)] = i * 10;
+	const map_type &view = map;
+
+	int *found = map.try_at("3");
+	*found += 1;
+	std::cout << *view.try_at("3") << " " << (view.try_at("9") == nullptr) << " " << map.at("4") << std::endl;
+
+	std::cout << map.try_erase(map.find("2")) << " " << map.try_erase(map.end()) << " "
+		<< map.try_erase(map_type::const_iterator()) << " " << map.size() << std::endl;
+	map_type other;
+	other["2"] = 2;
+	std::cout << map.try_erase(other.begin()) << " " << other.size() << std::endl;
+
+	std::cout << map.try_pop_front() << " " << map.try_pop_back() << " " << map.erase("4") << " " << map.erase("4") << std::endl;
+	for (map_type::const_iterator it = view.begin(); it != view.end(); ++it) std::cout << it->first << "=" << it->second << " ";
+	std::cout << std::endl;
+	while (map.try_pop_back()) {}
+	std::cout << map.empty() << " " << map.try_pop_front() << std::endl;
+
+	ranked_map ranked;
+	for (int i = 0; i < 1000; ++i) ranked[i] = i;
+	for (int i = 0; i < 1000; i += 3) ranked.try_erase(ranked.find(i));
+	long long sum = 0;
+	for (ranked_map::const_reverse_iterator it = ranked.crbegin(); it != ranked.crend(); ++it) sum += it->second;
+	std::cout << ranked.size() << " " << sum << " " << ranked.nth(10)->first << " "
+		<< ranked.position_of(ranked.find(500)) << std::endl;
+
+	sjtu::compact_linked_hashmap<int, int> compact;
+	for (int i = 0; i < 100; ++i) compact[i] = i;
+	sjtu::compact_linked_hashmap<int, int> moved(std::move(compact));
+	compact = moved;
+	compact.erase(compact.find(3));
+	int total = 0;
+	for (sjtu::compact_linked_hashmap<int, int>::const_iterator it = compact.cbegin(); it != compact.cend(); ++it) total += it->second;
+	std::cout << compact.size() << " " << total << " " << compact.at(5) << " " << moved.size() << std::endl;
+	return 0;
+}
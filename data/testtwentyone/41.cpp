@@ -0,0 +1,145 @@
+#include "linked_hashmap.hpp"
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * equal modulo 1000: the bytes of equal keys differ, so the key array
+ * must not be trusted.
+ */
+struct ModEqual {
+	bool operator () (int lhs, int rhs) const {
+		return lhs % 1000 == rhs % 1000;
+	}
+};
+
+struct ModHash {
+	size_t operator () (int key) const {
+		return std::hash<int>()(key % 1000);
+	}
+};
+
+/**
+ * looks int keys up by long long, too.
+ */
+struct WideHash {
+	typedef void is_transparent;
+
+	size_t operator () (long long key) const {
+		return std::hash<long long>()(key);
+	}
+};
+
+struct WideEqual {
+	typedef void is_transparent;
+
+	bool operator () (long long lhs, long long rhs) const {
+		return lhs == rhs;
+	}
+};
+
+enum class colour : unsigned int { red, green, blue };
+
+struct ColourHash {
+	size_t operator () (colour c) const {
+		return static_cast<size_t>(c);
+	}
+};
+
+template<class Key, class T, class Hash = std::hash<Key>, class Equal = std::equal_to<Key> >
+using int_map = sjtu::linked_hashmap<Key, T, Hash, Equal, sjtu::pool_allocator<sjtu::pair<const Key, T> >,
+	sjtu::pow2_mix_bucket, sjtu::auto_index<Key> >;
+
+static_assert(std::is_base_of<sjtu::integer_key_index, sjtu::auto_index<int> >::value, "int keys are inline");
+static_assert(std::is_base_of<sjtu::integer_key_index, sjtu::auto_index<const char *> >::value, "pointer keys are inline");
+static_assert(std::is_base_of<sjtu::chained_index, sjtu::auto_index<std::string> >::value, "strings are chained");
+static_assert(std::is_base_of<sjtu::chained_index, sjtu::auto_index<short> >::value, "only 4 or 8 bytes");
+static_assert(sjtu::bitwise_equal<colour, std::equal_to<colour> >::value, "enums compare bytes");
+static_assert(!sjtu::bitwise_equal<int, ModEqual>::value, "a custom Equal is not trusted");
+
+template<class Map>
+void print(const char *name, const Map &map) {
+	std::cout << name << " " << map.size() << ":";
+	for (typename Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) std::cout << " " << it->first;
+	std::cout << std::endl;
+}
+
+/**
+ * a churn of inserts and erases against a reference vector of flags.
+ */
+template<class Key, class Map>
+bool churn(Map &map, long long scale) {
+	std::vector<char> present(5000, 0);
+	unsigned long long state = 0x2545f4914f6cdd1dULL;
+	for (int step = 0; step < 60000; ++step) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		size_t i = state % present.size();
+		Key key = static_cast<Key>(static_cast<long long>(i) * scale);
+		if (state >> 62) {
+			if (map.insert(typename Map::value_type(key, step)).second == static_cast<bool>(present[i])) return false;
+			present[i] = 1;
+		} else {
+			if (map.erase(key) != static_cast<size_t>(present[i])) return false;
+			present[i] = 0;
+		}
+	}
+	size_t count = 0;
+	for (size_t i = 0; i < present.size(); ++i) {
+		Key key = static_cast<Key>(static_cast<long long>(i) * scale);
+		if ((map.find(key) != map.end()) != static_cast<bool>(present[i])) return false;
+		count += present[i];
+	}
+	return count == map.size();
+}
+
+int main() {
+	{
+		int_map<int, int> map;
+		for (int i = 0; i < 20; ++i) map[i * 7 - 50] = i;
+		std::cout << map.count(-50) << " " << map.count(-49) << " " << map.at(83) << " " << (map.find(1000) == map.end()) << std::endl;
+		map.erase(-43);
+		map.erase(map.find(6));
+		map[-43] = 100;
+		print("map", map);
+		int_map<int, int> copy(map);
+		map.clear();
+		std::cout << map.count(-43) << " " << copy.at(-43) << " " << copy.size() << std::endl;
+		map.swap(copy);
+		std::cout << map.count(-43) << " " << copy.empty() << std::endl;
+		map.rehash(1000);
+		map.rehash(0);
+		std::cout << map.at(-50) << " " << map.bucket_count() << std::endl;
+	}
+	{
+		int_map<long long, int> wide;
+		int_map<unsigned int, int> narrow;
+		std::cout << churn<long long>(wide, 1LL << 33) << " " << churn<unsigned int>(narrow, 65537) << std::endl;
+		int_map<int, int> dense;
+		std::cout << churn<int>(dense, 1) << " " << dense.load_factor() << std::endl;
+	}
+	{
+		int_map<int, std::string, ModHash, ModEqual> modular;
+		modular[5] = "five";
+		modular[1005] = "again";
+		modular[17] = "seventeen";
+		std::cout << modular.size() << " " << modular.at(2005) << " " << modular.count(3017) << " " << modular.count(6) << std::endl;
+
+		int_map<int, int, WideHash, WideEqual> transparent;
+		for (int i = 0; i < 100; ++i) transparent[i * 3] = i;
+		std::cout << transparent.count(27LL) << " " << transparent.count(28LL) << " " << transparent.at(297LL) << std::endl;
+
+		int_map<colour, const char *, ColourHash> names;
+		names[colour::blue] = "blue";
+		names[colour::red] = "red";
+		std::cout << names.at(colour::blue) << " " << names.count(colour::green) << " " << names.at(colour::red) << std::endl;
+
+		const char *words[] = {"alpha", "beta", "gamma"};
+		int_map<const char *, int> pointers;
+		for (int i = 0; i < 3; ++i) pointers[words[i]] = i;
+		std::cout << pointers.at(words[2]) << " " << pointers.count(words[0] + 1) << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,92 @@
+#include "linked_hashmap.hpp"
+#include "linked_hashmap_numa.hpp"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef sjtu::linked_hashmap<int, int, std::hash<int>, std::equal_to<int>,
+	sjtu::hugepage_allocator<sjtu::pair<const int, int>, sjtu::huge_2mb, sjtu::numa_interleave<> > > huge_map;
+typedef sjtu::linked_hashmap<int, int, std::hash<int>, std::equal_to<int>,
+	sjtu::hugepage_allocator<sjtu::pair<const int, int>, sjtu::small_pages, sjtu::numa_bind<0> > > bound_map;
+typedef sjtu::linked_hashmap<int, std::string, std::hash<int>, std::equal_to<int>,
+	sjtu::hugepage_allocator<sjtu::pair<const int, std::string>, sjtu::huge_1gb>, sjtu::pow2_mix_bucket, sjtu::swiss_index> gigantic_map;
+typedef sjtu::replicated_linked_hashmap<int, int> replicated_map;
+
+/**
+ * every key 0, step, 2 * step... below limit once, in order.
+ */
+template<class Map>
+bool check(const Map &map, int limit, int step) {
+	int expected = 0;
+	for (typename Map::const_iterator it = map.cbegin(); it != map.cend(); ++it, expected += step) {
+		if (it->first != expected || it->second != expected * 2) return false;
+	}
+	return expected >= limit && map.size() == static_cast<size_t>((limit + step - 1) / step);
+}
+
+int main() {
+	{
+		std::cout << sjtu::mapped_source<>::usable_size(100) << " "
+			<< sjtu::mapped_source<>::usable_size(sjtu::huge_2mb::min_request) << " "
+			<< sjtu::mapped_source<sjtu::small_pages>::usable_size(70000) << std::endl;
+	}
+	{
+		huge_map map;
+		for (int i = 0; i < 300000; ++i) map[i] = i * 2;
+		for (int i = 1; i < 300000; i += 2) map.erase(i);
+		std::cout << map.size() << " " << map.at(299998) << " " << map.count(299999) << " " << check(map, 300000, 2) << std::endl;
+		huge_map copy(map);
+		map.clear();
+		for (int i = 0; i < 1000; ++i) map[i] = i * 2;
+		std::cout << check(map, 1000, 1) << " " << check(copy, 300000, 2) << std::endl;
+		map.swap(copy);
+		map.rehash(1 << 20);
+		std::cout << map.bucket_count() << " " << check(map, 300000, 2) << std::endl;
+	}
+	{
+		bound_map map;
+		map.reserve(50000);
+		for (int i = 0; i < 50000; ++i) map[i] = i * 2;
+		std::cout << check(map, 50000, 1) << std::endl;
+
+		gigantic_map small;
+		for (int i = 0; i < 100; ++i) small[i] = std::to_string(i);
+		std::cout << small.size() << " " << small.at(42) << std::endl;
+	}
+	{
+		replicated_map shared;
+		for (int i = 0; i < 1000; ++i) shared.insert_or_assign(i, i);
+		replicated_map::replica mine = shared.make_replica();
+		std::cout << mine.get().size() << " " << mine.version() << " " << shared.version() << std::endl;
+
+		shared.insert_or_assign(5, 50);
+		shared.erase(6);
+		shared.erase(6);
+		std::cout << mine.cached().at(5) << " " << mine.get().at(5) << " " << mine.get().count(6) << " " << mine.version() << std::endl;
+		shared.update([](replicated_map::map_type &map) {
+			map.touch(map.find(0));
+		});
+		std::cout << mine.get().cbegin()->first << " " << (--mine.get().cend())->first << std::endl;
+
+		// readers copy on their own threads while a writer keeps going.
+		std::vector<int> ok(2, 1);
+		std::vector<std::thread> readers;
+		for (int r = 0; r < 2; ++r) {
+			readers.emplace_back([&shared, &ok, r] {
+				replicated_map::replica local(shared);
+				for (int step = 0; step < 2000; ++step) {
+					const replicated_map::map_type &map = local.get();
+					const int *value = map.try_at(7);
+					if (!value || *value % 7 != 0) ok[r] = 0;
+				}
+			});
+		}
+		for (int i = 1; i <= 200; ++i) shared.insert_or_assign(7, i * 7);
+		for (size_t r = 0; r < readers.size(); ++r) readers[r].join();
+		std::cout << ok[0] << " " << ok[1] << " " << mine.get().at(7) << " " << shared.size() << std::endl;
+		shared.clear();
+		std::cout << mine.get().empty() << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,96 @@
+#include "linked_hashmap.hpp"
+#include "linked_hashmap_stats.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * every key in one bucket, with one tag: the scan has to look further.
+ */
+struct ConstantHash {
+	size_t operator () (int) const {
+		return 42;
+	}
+};
+
+typedef sjtu::linked_hashmap<int, std::string, std::hash<int>, std::equal_to<int>,
+	sjtu::pool_allocator<sjtu::pair<const int, std::string> >, sjtu::pow2_mix_bucket, sjtu::small_index<4> > small_map;
+typedef sjtu::linked_hashmap<int, int, ConstantHash, std::equal_to<int>,
+	sjtu::pool_allocator<sjtu::pair<const int, int> >, sjtu::pow2_mix_bucket, sjtu::small_index<> > colliding_map;
+typedef sjtu::linked_hashmap<int, int, std::hash<int>, std::equal_to<int>,
+	sjtu::pool_allocator<sjtu::pair<const int, int> >, sjtu::pow2_mix_bucket,
+	sjtu::stats_index<sjtu::small_index<8, sjtu::swiss_index> > > counted_map;
+
+template<class Map>
+void print(const char *name, const Map &map) {
+	std::cout << name << " " << map.size() << " " << map.bucket_count() << ":";
+	for (typename Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) std::cout << " " << it->first;
+	std::cout << std::endl;
+}
+
+int main() {
+	{
+		small_map map;
+		for (int i = 1; i <= 4; ++i) map[i * 10] = std::to_string(i);
+		print("small", map);
+		map.erase(20);
+		map[50] = "5";
+		std::cout << map.at(40) << " " << map.count(20) << " " << map.count(50) << std::endl;
+		print("small", map);
+
+		small_map copy(map);
+		map[60] = "6";
+		print("spilled", map);
+		std::cout << map.at(10) << " " << map.at(60) << " " << map.count(20) << std::endl;
+		print("copy", copy);
+
+		map.swap(copy);
+		print("map", map);
+		print("copy", copy);
+		map.clear();
+		copy.clear();
+		print("cleared", map);
+		print("cleared", copy);
+		copy[7] = "7";
+		std::cout << copy.at(7) << " " << copy.count(70) << std::endl;
+
+		small_map reserved;
+		reserved.reserve(100);
+		std::cout << (reserved.bucket_count() >= 100) << std::endl;
+	}
+	{
+		colliding_map map;
+		for (int i = 0; i < 8; ++i) map[i] = i * i;
+		std::cout << map.bucket_count() << " " << map.at(7) << " " << map.count(8) << std::endl;
+		map.erase(0);
+		map.erase(map.find(5));
+		for (int i = 0; i < 8; ++i) std::cout << map.count(i);
+		std::cout << std::endl;
+		for (int i = 8; i < 40; ++i) map[i] = i;
+		int found = 0;
+		for (int i = 0; i < 40; ++i) found += static_cast<int>(map.count(i));
+		std::cout << found << " " << map.size() << " " << (map.bucket_count() > 8) << std::endl;
+	}
+	{
+		counted_map map;
+		for (int i = 0; i < 8; ++i) map[i] = i;
+		std::vector<size_t> histogram = map.bucket_histogram();
+		std::cout << map.stats().rehashes << " " << histogram.size() << " " << histogram.back() << std::endl;
+		map[8] = 8;
+		std::cout << map.stats().rehashes << " " << map.bucket_count() << " " << map.at(8) << std::endl;
+	}
+	{
+		// many tiny maps, each below the limit.
+		std::vector<small_map> maps(1000);
+		for (size_t m = 0; m < maps.size(); ++m) {
+			for (int i = 0; i < static_cast<int>(m % 5); ++i) maps[m][i] = std::to_string(m);
+		}
+		size_t total = 0, small = 0;
+		for (size_t m = 0; m < maps.size(); ++m) {
+			total += maps[m].size();
+			if (maps[m].bucket_count() == 4) ++small;
+		}
+		std::cout << total << " " << small << " " << maps[999].at(3) << std::endl;
+	}
+	return 0;
+}
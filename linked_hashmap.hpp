@@ -4,13 +4,2272 @@
 #ifndef SJTU_LINKEDHASHMAP_HPP
 #define SJTU_LINKEDHASHMAP_HPP
 
-// only for std::equal_to<T> and std::hash<T>
+// only for std::equal_to<T>, std::hash<T> and std::function (the eviction callback)
 #include <functional>
+// only for std::bidirectional_iterator_tag and std::reverse_iterator
+#include <iterator>
 #include <cstddef>
+#include <cstring>
+#include <cmath>
+// only for malloc/calloc/free in heap_source, and abort without exceptions
+#include <cstdlib>
+// only for SJTU_ASSERT_CHECKS
+#include <cassert>
+// only for placement new
+#include <new>
+// only for std::is_empty (whether moved nodes keep their cached hashes)
+#include <type_traits>
+// only for the group probing of swiss_index and integer_key_index
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 #include "utility.hpp"
 #include "exceptions.hpp"
 
-namespace sjtu {
+    /**
+     * How linked_hashmap reports a broken precondition (at() of a missing
+     *   key, an iterator stepped past end(), erase(end())...).
+     * By default it throws the exceptions of exceptions.hpp. With
+     *   SJTU_ASSERT_CHECKS, which is implied by -fno-exceptions, each check
+     *   is an assert instead: it aborts a debug build, vanishes with NDEBUG,
+     *   and breaking the precondition is then undefined. try_at, try_erase
+     *   and the other try_ members report failure in their result in both
+     *   modes and carry no exception machinery.
+     * Without exceptions, a failed allocation aborts.
+     */
+#if !defined(__cpp_exceptions) && !defined(__EXCEPTIONS)
+#define SJTU_NO_EXCEPTIONS
+#ifndef SJTU_ASSERT_CHECKS
+#define SJTU_ASSERT_CHECKS
+#endif
+#endif
+
+#if defined(SJTU_ASSERT_CHECKS) && defined(NDEBUG)
+#define SJTU_CHECK(ok, error) ((void)sizeof(!(ok)))
+#elif defined(SJTU_ASSERT_CHECKS)
+#define SJTU_CHECK(ok, error) assert((ok) && #error)
+#else
+#define SJTU_CHECK(ok, error) do { if (!(ok)) throw error(); } while (0)
+#endif
+
+#if defined(SJTU_NO_EXCEPTIONS)
+#define SJTU_TRY if (true)
+#define SJTU_CATCH_ALL if (false)
+#define SJTU_RETHROW ((void)0)
+#define SJTU_THROW_BAD_ALLOC std::abort()
+#else
+#define SJTU_TRY try
+#define SJTU_CATCH_ALL catch (...)
+#define SJTU_RETHROW throw
+#define SJTU_THROW_BAD_ALLOC throw std::bad_alloc()
+#endif
+
+namespace sjtu {
+    /**
+     * Where pool_allocator gets its memory: slabs and arrays of bytes.
+     * A source is a set of static members, so allocators stay one pointer:
+     *   allocate(bytes) and allocate_zeroed(bytes) return memory aligned
+     *   for any object, or report bad_alloc;
+     *   deallocate(ptr, bytes) takes the size it was allocated with;
+     *   usable_size(bytes) is how much a request of bytes really gets, so
+     *   that a slab may fill all of it.
+     * linked_hashmap_numa.hpp has sources backed by huge pages.
+     */
+struct heap_source {
+	static void * allocate(size_t bytes) {
+		void *raw = std::malloc(bytes);
+		if (!raw) SJTU_THROW_BAD_ALLOC;
+		return raw;
+	}
+
+	static void * allocate_zeroed(size_t bytes) {
+		void *raw = std::calloc(bytes, 1);
+		if (!raw) SJTU_THROW_BAD_ALLOC;
+		return raw;
+	}
+
+	static void deallocate(void *ptr, size_t) {
+		std::free(ptr);
+	}
+
+	static size_t usable_size(size_t bytes) {
+		return bytes;
+	}
+};
+
+    /**
+     * A slab allocator for the nodes of linked_hashmap.
+     * Single objects are carved out of large blocks and recycled through
+     * a free list, so insert/erase churn never reaches the global heap.
+     * The first block holds only a few objects, so that a tiny map stays
+     * tiny; each next one is twice as large.
+     * Array requests (like bucket tables) go straight to the Source, and
+     * allocate_zeroed() asks it for zeroed memory, which heap_source gets
+     * from calloc: fresh pages the system zeroes lazily instead of us
+     * touching every byte up front.
+     *
+     * Copies share one pool; a rebound copy starts a pool of its own.
+     * The pool is created lazily by the first allocation and destroyed
+     * together with its last owner.
+     */
+template<class T, class Source = heap_source>
+class pool_allocator {
+public:
+	typedef T value_type;
+	typedef size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+private:
+	union Slot {
+		Slot *next;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	struct Slab {
+		Slab *next;
+		size_t bytes;
+	};
+
+	struct Pool {
+		size_t refs;
+		size_t live;
+		size_t next_slab_slots;
+		Slab *slabs;
+		Slot *free_list;
+		Slot *bump;
+		Slot *bump_end;
+
+		Pool() : refs(1), live(0), next_slab_slots(INITIAL_SLAB_SLOTS), slabs(nullptr),
+			free_list(nullptr), bump(nullptr), bump_end(nullptr) {}
+	};
+
+	static const size_t INITIAL_SLAB_SLOTS = 4;
+	static const size_t MAX_SLAB_SLOTS = 8192;
+	static const size_t SLAB_HEADER = (sizeof(Slab) + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+
+	mutable Pool *pool;
+
+	Pool *acquire() const {
+		if (!pool) pool = new Pool();
+		return pool;
+	}
+
+	static void free_slabs(Pool *p) {
+		Slab *curr = p->slabs;
+		while (curr) {
+			Slab *next = curr->next;
+			Source::deallocate(curr, curr->bytes);
+			curr = next;
+		}
+		p->slabs = nullptr;
+		p->free_list = nullptr;
+		p->bump = p->bump_end = nullptr;
+		p->next_slab_slots = INITIAL_SLAB_SLOTS;
+	}
+
+	static void grow(Pool *p) {
+		add_slab(p, p->next_slab_slots);
+		if (p->next_slab_slots < MAX_SLAB_SLOTS) p->next_slab_slots *= 2;
+	}
+
+	static void add_slab(Pool *p, size_t slots) {
+		size_t bytes = Source::usable_size(SLAB_HEADER + slots * sizeof(Slot));
+		char *raw = static_cast<char *>(Source::allocate(bytes));
+		Slab *slab = reinterpret_cast<Slab *>(raw);
+		slab->next = p->slabs;
+		slab->bytes = bytes;
+		slots = (bytes - SLAB_HEADER) / sizeof(Slot);
+		p->slabs = slab;
+		p->bump = reinterpret_cast<Slot *>(raw + SLAB_HEADER);
+		p->bump_end = p->bump + slots;
+	}
+
+	void drop() {
+		if (pool && --pool->refs == 0) {
+			free_slabs(pool);
+			delete pool;
+		}
+		pool = nullptr;
+	}
+
+	template<class U, class S> friend class pool_allocator;
+
+public:
+	pool_allocator() noexcept : pool(nullptr) {}
+	pool_allocator(const pool_allocator &other) : pool(other.acquire()) {
+		++pool->refs;
+	}
+	pool_allocator(pool_allocator &&other) noexcept : pool(other.pool) {
+		other.pool = nullptr;
+	}
+	template<class U>
+	pool_allocator(const pool_allocator<U, Source> &) noexcept : pool(nullptr) {}
+
+	pool_allocator & operator=(const pool_allocator &other) {
+		if (pool == other.pool) return *this;
+		Pool *p = other.acquire();
+		++p->refs;
+		drop();
+		pool = p;
+		return *this;
+	}
+
+	pool_allocator & operator=(pool_allocator &&other) noexcept {
+		if (this == &other) return *this;
+		drop();
+		pool = other.pool;
+		other.pool = nullptr;
+		return *this;
+	}
+
+	void swap(pool_allocator &other) noexcept {
+		Pool *p = pool;
+		pool = other.pool;
+		other.pool = p;
+	}
+
+	~pool_allocator() {
+		drop();
+	}
+
+	T * allocate(size_t n) {
+		if (n != 1) return static_cast<T *>(Source::allocate(n * sizeof(T)));
+		Pool *p = acquire();
+		Slot *slot;
+		if (p->free_list) {
+			slot = p->free_list;
+			p->free_list = slot->next;
+		} else {
+			if (p->bump == p->bump_end) grow(p);
+			slot = p->bump++;
+		}
+		++p->live;
+		return reinterpret_cast<T *>(slot);
+	}
+
+	void deallocate(T *ptr, size_t n) {
+		if (n != 1) {
+			Source::deallocate(ptr, n * sizeof(T));
+			return;
+		}
+		Slot *slot = reinterpret_cast<Slot *>(ptr);
+		slot->next = pool->free_list;
+		pool->free_list = slot;
+		--pool->live;
+	}
+
+	/**
+	 * an array of n all-zero-bytes objects; free it with deallocate(ptr, n).
+	 */
+	T * allocate_zeroed(size_t n) {
+		if (n == 1) {
+			T *result = allocate(1);
+			memset(static_cast<void *>(result), 0, sizeof(T));
+			return result;
+		}
+		return static_cast<T *>(Source::allocate_zeroed(n * sizeof(T)));
+	}
+
+	/**
+	 * makes the next n single allocations come out of one contiguous slab.
+	 * what is left of the current slab goes to the free list first.
+	 */
+	void reserve(size_t n) {
+		Pool *p = acquire();
+		if (static_cast<size_t>(p->bump_end - p->bump) >= n) return;
+		while (p->bump != p->bump_end) {
+			Slot *slot = p->bump++;
+			slot->next = p->free_list;
+			p->free_list = slot;
+		}
+		add_slab(p, n);
+	}
+
+	/**
+	 * hands every slab back to the Source.
+	 * does nothing while any object of the pool is still alive.
+	 */
+	void release() {
+		if (pool && pool->live == 0) free_slabs(pool);
+	}
+
+	bool operator==(const pool_allocator &rhs) const {
+		return this == &rhs || (pool && pool == rhs.pool);
+	}
+
+	bool operator!=(const pool_allocator &rhs) const {
+		return !(*this == rhs);
+	}
+};
+
+    /**
+     * rebind_alloc<Alloc, U>::type is the allocator of U of the same family,
+     * e.g. std::allocator<int> -> std::allocator<U>.
+     */
+template<class Alloc, class U> struct rebind_alloc;
+
+template<template<class, class...> class Alloc, class T, class... Args, class U>
+struct rebind_alloc<Alloc<T, Args...>, U> {
+	typedef Alloc<U, Args...> type;
+};
+
+    /**
+     * the allocator a copied container starts with.
+     * pools are never shared between containers, so a copy gets a fresh one.
+     */
+template<class Alloc>
+Alloc select_on_copy(const Alloc &alloc) {
+	return alloc;
+}
+
+template<class T, class Source>
+pool_allocator<T, Source> select_on_copy(const pool_allocator<T, Source> &) {
+	return pool_allocator<T, Source>();
+}
+
+    /**
+     * gives unused memory back once a container is emptied.
+     */
+template<class Alloc>
+void release_unused(Alloc &) {}
+
+template<class T, class Source>
+void release_unused(pool_allocator<T, Source> &alloc) {
+	alloc.release();
+}
+
+    /**
+     * heterogeneous lookup: when both Hash and Equal declare is_transparent,
+     * find/count/at/erase take any key type they accept.
+     * lookup_result<Hash, Equal, K, R>::type is R in that case and missing
+     * otherwise, which drops those overloads.
+     */
+template<class> struct void_type {
+	typedef void type;
+};
+
+template<class T, class = void>
+struct has_is_transparent {
+	static const bool value = false;
+};
+
+template<class T>
+struct has_is_transparent<T, typename void_type<typename T::is_transparent>::type> {
+	static const bool value = true;
+};
+
+template<class Hash, class Equal, class K, class R,
+	bool = has_is_transparent<Hash>::value && has_is_transparent<Equal>::value>
+struct lookup_result {};
+
+template<class Hash, class Equal, class K, class R>
+struct lookup_result<Hash, Equal, K, R, true> {
+	typedef R type;
+};
+
+    /**
+     * an array of n null pointers (or other zero-initialized scalars).
+     */
+template<class Alloc>
+typename Alloc::value_type * allocate_zeroed(Alloc &alloc, size_t n) {
+	typename Alloc::value_type *result = alloc.allocate(n);
+	for (size_t i = 0; i < n; ++i) {
+		result[i] = typename Alloc::value_type();
+	}
+	return result;
+}
+
+template<class T, class Source>
+T * allocate_zeroed(pool_allocator<T, Source> &alloc, size_t n) {
+	return alloc.allocate_zeroed(n);
+}
+
+    /**
+     * warns the allocator that n single objects are about to be allocated.
+     */
+template<class Alloc>
+void reserve_nodes(Alloc &, size_t) {}
+
+template<class T, class Source>
+void reserve_nodes(pool_allocator<T, Source> &alloc, size_t n) {
+	alloc.reserve(n);
+}
+
+    /**
+     * Bucket-index policies of linked_hashmap.
+     * A policy turns the result of Hash into the value cached in every node
+     * (mix), maps such a value to a bucket (index), and picks the legal
+     * bucket count to use for a requested one (bucket_count_for).
+     */
+
+    /**
+     * power-of-two bucket counts, indexed by masking.
+     * The murmur3 finalizer scrambles the hash first, so weak hashers
+     * (like the identity std::hash<int>) still spread over the low bits.
+     */
+struct pow2_mix_bucket {
+	static const bool power_of_two = true;
+
+	static size_t mix(size_t hash) {
+		unsigned long long x = hash;
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdULL;
+		x ^= x >> 33;
+		x *= 0xc4ceb9fe1a85ec53ULL;
+		x ^= x >> 33;
+		return static_cast<size_t>(x);
+	}
+
+	static size_t index(size_t hash, size_t bucket_count) {
+		return hash & (bucket_count - 1);
+	}
+
+	static size_t bucket_count_for(size_t count) {
+		size_t result = 1;
+		while (result < count) result <<= 1;
+		return result;
+	}
+};
+
+    /**
+     * prime bucket counts, indexed by modulo.
+     * The hash is used as it is, for hashers that are designed around it.
+     */
+struct prime_mod_bucket {
+	static const bool power_of_two = false;
+
+	static size_t mix(size_t hash) {
+		return hash;
+	}
+
+	static size_t index(size_t hash, size_t bucket_count) {
+		return hash % bucket_count;
+	}
+
+	static size_t bucket_count_for(size_t count) {
+		static const unsigned long long primes[] = {
+			17ULL, 37ULL, 67ULL, 131ULL, 257ULL, 521ULL,
+			1031ULL, 2053ULL, 4099ULL, 8209ULL, 16411ULL, 32771ULL,
+			65537ULL, 131101ULL, 262147ULL, 524309ULL, 1048583ULL, 2097169ULL,
+			4194319ULL, 8388617ULL, 16777259ULL, 33554467ULL, 67108879ULL, 134217757ULL,
+			268435459ULL, 536870923ULL, 1073741827ULL, 2147483659ULL, 4294967311ULL, 8589934609ULL,
+			17179869209ULL, 34359738421ULL, 68719476767ULL, 137438953481ULL, 274877906951ULL, 549755813911ULL,
+			1099511627791ULL, 2199023255579ULL, 4398046511119ULL, 8796093022237ULL, 17592186044423ULL, 35184372088891ULL,
+			70368744177679ULL, 140737488355333ULL
+		};
+		const size_t total = sizeof(primes) / sizeof(primes[0]);
+		for (size_t i = 0; i < total; ++i) {
+			if (primes[i] >= count) return static_cast<size_t>(primes[i]);
+		}
+		return static_cast<size_t>(primes[total - 1]);
+	}
+};
+
+    /**
+     * Index engines of linked_hashmap.
+     * The insertion-order list owns the nodes; an engine only finds them
+     * again from their cached hash. An engine provides
+     *   hook<Node>: the fields it needs inside every node,
+     *   table<Node, BucketPolicy, Allocator>: the index itself.
+     * Batched lookups call prefetch_bucket(hash) on a whole batch, then
+     * prefetch_entry(hash), then find, so the cache misses overlap.
+     * for_each_bucket(visit) calls visit(entries) on every bucket, for
+     * diagnostics only (see linked_hashmap_stats.hpp).
+     * for_each_in(part, parts, visit) calls visit(node) on the nodes of the
+     * part-th of parts equal slices of the table, so that parallel scans
+     * (see parallel_linked_hashmap.hpp) split the work without walking the
+     * order list; together the slices hold every node once.
+     * find(hash, pred) calls pred(node) on candidates; pred.key is the key
+     * looked for, for engines that order their entries.
+     * policy(p) makes a table use the BucketPolicy (and so the seed, if any)
+     * of another one; it is only called while the table holds no element.
+     */
+
+    /**
+     * a hint that *address will be read soon; a no-op where unsupported.
+     */
+inline void prefetch_address(const void *address) {
+#if defined(__GNUC__)
+	__builtin_prefetch(address);
+#else
+	(void)address;
+#endif
+}
+
+    /**
+     * the first of n items that slice part of parts starts at.
+     */
+inline size_t slice_begin(size_t n, size_t part, size_t parts) {
+	return n / parts * part + n % parts * part / parts;
+}
+
+    /**
+     * separate chaining: an array of buckets, each one a singly linked
+     * chain running through Node::hash_next.
+     * An empty table uses a single bucket inside itself, so it never allocates.
+     */
+struct chained_index {
+	template<class Node>
+	struct hook {
+		Node *hash_next;
+
+		hook() : hash_next(nullptr) {}
+	};
+
+	template<class Node, class BucketPolicy, class Allocator>
+	class table {
+	private:
+		typedef typename rebind_alloc<Allocator, Node *>::type bucket_allocator;
+
+		Node **buckets;
+		size_t count;
+		Node *single_bucket;
+		float max_load;
+		BucketPolicy bucket_policy;
+		bucket_allocator alloc;
+
+		static const size_t MIN_BUCKET_COUNT = 16;
+
+		Node ** allocate_buckets(size_t n) {
+			if (n == 1) {
+				single_bucket = nullptr;
+				return &single_bucket;
+			}
+			return allocate_zeroed(alloc, n);
+		}
+
+		void deallocate_buckets(Node **table, size_t n) {
+			if (table != &single_bucket) alloc.deallocate(table, n);
+		}
+
+	public:
+		explicit table(const Allocator &a = Allocator()) noexcept
+			: buckets(&single_bucket), count(1), single_bucket(nullptr), max_load(0.75f), alloc(a) {}
+		table(const table &) = delete;
+		table & operator=(const table &) = delete;
+
+		~table() {
+			deallocate_buckets(buckets, count);
+		}
+
+		const BucketPolicy & policy() const {
+			return bucket_policy;
+		}
+
+		void policy(const BucketPolicy &p) {
+			bucket_policy = p;
+		}
+
+		void swap(table &other) noexcept {
+			bool single = buckets == &single_bucket;
+			bool other_single = other.buckets == &other.single_bucket;
+			std::swap(buckets, other.buckets);
+			std::swap(count, other.count);
+			std::swap(single_bucket, other.single_bucket);
+			std::swap(max_load, other.max_load);
+			std::swap(bucket_policy, other.bucket_policy);
+			std::swap(alloc, other.alloc);
+			if (other_single) buckets = &single_bucket;
+			if (single) other.buckets = &other.single_bucket;
+		}
+
+		size_t bucket_count() const {
+			return count;
+		}
+
+		float max_load_factor() const {
+			return max_load;
+		}
+
+		void max_load_factor(float ml) {
+			max_load = ml;
+		}
+
+		template<class Pred>
+		Node* find(size_t hash, Pred pred) const {
+			Node *curr = buckets[bucket_policy.index(hash, count)];
+			while (curr) {
+				if (curr->hash == hash && pred(curr)) {
+					return curr;
+				}
+				curr = curr->hash_next;
+			}
+			return nullptr;
+		}
+
+		void prefetch_bucket(size_t hash) const {
+			prefetch_address(buckets + bucket_policy.index(hash, count));
+		}
+
+		/**
+		 * the head node of the chain; the bucket should be cached by now.
+		 */
+		void prefetch_entry(size_t hash) const {
+			Node *head = buckets[bucket_policy.index(hash, count)];
+			if (head) prefetch_address(head);
+		}
+
+		void insert(Node *node) {
+			size_t idx = bucket_policy.index(node->hash, count);
+			node->hash_next = buckets[idx];
+			buckets[idx] = node;
+		}
+
+		void erase(Node *node) {
+			Node **curr_ptr = &buckets[bucket_policy.index(node->hash, count)];
+			while (*curr_ptr) {
+				if (*curr_ptr == node) {
+					*curr_ptr = node->hash_next;
+					break;
+				}
+				curr_ptr = &((*curr_ptr)->hash_next);
+			}
+		}
+
+		template<class Visit>
+		void for_each_bucket(Visit visit) const {
+			for (size_t i = 0; i < count; ++i) {
+				size_t length = 0;
+				for (Node *curr = buckets[i]; curr; curr = curr->hash_next) ++length;
+				visit(length);
+			}
+		}
+
+		template<class Visit>
+		void for_each_in(size_t part, size_t parts, Visit visit) const {
+			for (size_t i = slice_begin(count, part, parts); i < slice_begin(count, part + 1, parts); ++i) {
+				for (Node *curr = buckets[i]; curr; curr = curr->hash_next) visit(curr);
+			}
+		}
+
+		void clear() {
+			for (size_t i = 0; i < count; ++i) {
+				buckets[i] = nullptr;
+			}
+		}
+
+		void rehash(size_t n) {
+			Node **old_buckets = buckets;
+			size_t old_count = count;
+			Node *old_single = single_bucket;
+			if (old_buckets == &single_bucket) old_buckets = &old_single;
+
+			count = bucket_policy.bucket_count_for(n);
+			buckets = allocate_buckets(count);
+
+			for (size_t i = 0; i < old_count; ++i) {
+				Node *curr = old_buckets[i];
+				while (curr) {
+					Node *next = curr->hash_next;
+					insert(curr);
+					curr = next;
+				}
+			}
+
+			if (old_buckets != &old_single) alloc.deallocate(old_buckets, old_count);
+		}
+
+		/**
+		 * make room for one more element, given the current number of elements.
+		 */
+		void prepare_insert(size_t size) {
+			if (size > count * max_load) {
+				size_t target = count * 2 > MIN_BUCKET_COUNT ? count * 2 : MIN_BUCKET_COUNT;
+				size_t needed = static_cast<size_t>(size / max_load) + 1;
+				rehash(target > needed ? target : needed);
+			}
+		}
+	};
+};
+
+    /**
+     * chained_index with a back link in every node: hash_pprev points at
+     * whatever points at the node (its bucket or the hash_next of the node
+     * before it), so erase unlinks in O(1) without walking the chain or
+     * looking at the hash. It costs one pointer per node.
+     * The single bucket of an empty table is re-pointed on swap.
+     */
+struct doubly_chained_index {
+	template<class Node>
+	struct hook {
+		Node *hash_next;
+		Node **hash_pprev;
+
+		hook() : hash_next(nullptr), hash_pprev(nullptr) {}
+	};
+
+	template<class Node, class BucketPolicy, class Allocator>
+	class table {
+	private:
+		typedef typename rebind_alloc<Allocator, Node *>::type bucket_allocator;
+
+		Node **buckets;
+		size_t count;
+		Node *single_bucket;
+		float max_load;
+		BucketPolicy bucket_policy;
+		bucket_allocator alloc;
+
+		static const size_t MIN_BUCKET_COUNT = 16;
+
+		Node ** allocate_buckets(size_t n) {
+			if (n == 1) {
+				single_bucket = nullptr;
+				return &single_bucket;
+			}
+			return allocate_zeroed(alloc, n);
+		}
+
+		void deallocate_buckets(Node **table, size_t n) {
+			if (table != &single_bucket) alloc.deallocate(table, n);
+		}
+
+		static void push(Node **bucket, Node *node) {
+			node->hash_next = *bucket;
+			node->hash_pprev = bucket;
+			if (*bucket) (*bucket)->hash_pprev = &node->hash_next;
+			*bucket = node;
+		}
+
+		/**
+		 * the chain of the single bucket points back into the table itself.
+		 */
+		void repoint_single() {
+			if (buckets == &single_bucket && single_bucket) single_bucket->hash_pprev = &single_bucket;
+		}
+
+	public:
+		explicit table(const Allocator &a = Allocator()) noexcept
+			: buckets(&single_bucket), count(1), single_bucket(nullptr), max_load(0.75f), alloc(a) {}
+		table(const table &) = delete;
+		table & operator=(const table &) = delete;
+
+		~table() {
+			deallocate_buckets(buckets, count);
+		}
+
+		const BucketPolicy & policy() const {
+			return bucket_policy;
+		}
+
+		void policy(const BucketPolicy &p) {
+			bucket_policy = p;
+		}
+
+		void swap(table &other) noexcept {
+			bool single = buckets == &single_bucket;
+			bool other_single = other.buckets == &other.single_bucket;
+			std::swap(buckets, other.buckets);
+			std::swap(count, other.count);
+			std::swap(single_bucket, other.single_bucket);
+			std::swap(max_load, other.max_load);
+			std::swap(bucket_policy, other.bucket_policy);
+			std::swap(alloc, other.alloc);
+			if (other_single) buckets = &single_bucket;
+			if (single) other.buckets = &other.single_bucket;
+			repoint_single();
+			other.repoint_single();
+		}
+
+		size_t bucket_count() const {
+			return count;
+		}
+
+		float max_load_factor() const {
+			return max_load;
+		}
+
+		void max_load_factor(float ml) {
+			max_load = ml;
+		}
+
+		template<class Pred>
+		Node* find(size_t hash, Pred pred) const {
+			Node *curr = buckets[bucket_policy.index(hash, count)];
+			while (curr) {
+				if (curr->hash == hash && pred(curr)) {
+					return curr;
+				}
+				curr = curr->hash_next;
+			}
+			return nullptr;
+		}
+
+		void prefetch_bucket(size_t hash) const {
+			prefetch_address(buckets + bucket_policy.index(hash, count));
+		}
+
+		void prefetch_entry(size_t hash) const {
+			Node *head = buckets[bucket_policy.index(hash, count)];
+			if (head) prefetch_address(head);
+		}
+
+		void insert(Node *node) {
+			push(&buckets[bucket_policy.index(node->hash, count)], node);
+		}
+
+		void erase(Node *node) {
+			*node->hash_pprev = node->hash_next;
+			if (node->hash_next) node->hash_next->hash_pprev = node->hash_pprev;
+		}
+
+		template<class Visit>
+		void for_each_bucket(Visit visit) const {
+			for (size_t i = 0; i < count; ++i) {
+				size_t length = 0;
+				for (Node *curr = buckets[i]; curr; curr = curr->hash_next) ++length;
+				visit(length);
+			}
+		}
+
+		template<class Visit>
+		void for_each_in(size_t part, size_t parts, Visit visit) const {
+			for (size_t i = slice_begin(count, part, parts); i < slice_begin(count, part + 1, parts); ++i) {
+				for (Node *curr = buckets[i]; curr; curr = curr->hash_next) visit(curr);
+			}
+		}
+
+		void clear() {
+			for (size_t i = 0; i < count; ++i) {
+				buckets[i] = nullptr;
+			}
+		}
+
+		void rehash(size_t n) {
+			Node **old_buckets = buckets;
+			size_t old_count = count;
+			Node *old_single = single_bucket;
+			if (old_buckets == &single_bucket) old_buckets = &old_single;
+
+			count = bucket_policy.bucket_count_for(n);
+			buckets = allocate_buckets(count);
+
+			for (size_t i = 0; i < old_count; ++i) {
+				Node *curr = old_buckets[i];
+				while (curr) {
+					Node *next = curr->hash_next;
+					insert(curr);
+					curr = next;
+				}
+			}
+
+			if (old_buckets != &old_single) alloc.deallocate(old_buckets, old_count);
+		}
+
+		void prepare_insert(size_t size) {
+			if (size > count * max_load) {
+				size_t target = count * 2 > MIN_BUCKET_COUNT ? count * 2 : MIN_BUCKET_COUNT;
+				size_t needed = static_cast<size_t>(size / max_load) + 1;
+				rehash(target > needed ? target : needed);
+			}
+		}
+	};
+};
+
+    /**
+     * separate chaining that grows incrementally, like the dict of Redis.
+     * Crossing the load factor allocates the bigger bucket array but moves
+     * nothing yet; every later insert and erase then migrates a few buckets
+     * of the old array, and lookups consult both until it is drained.
+     * No single insert pays for a whole rehash.
+     * An explicit rehash (rehash/reserve/shrink_to_fit) still runs to completion.
+     */
+struct incremental_index {
+	template<class Node>
+	struct hook {
+		Node *hash_next;
+
+		hook() : hash_next(nullptr) {}
+	};
+
+	template<class Node, class BucketPolicy, class Allocator>
+	class table {
+	private:
+		typedef typename rebind_alloc<Allocator, Node *>::type bucket_allocator;
+
+		struct bucket_array {
+			Node **buckets;
+			size_t count;
+		};
+
+		bucket_array active;
+		bucket_array draining;
+		size_t migrated;
+		Node *single_bucket;
+		float max_load;
+		BucketPolicy bucket_policy;
+		bucket_allocator alloc;
+
+		static const size_t MIN_BUCKET_COUNT = 16;
+		/**
+		 * per operation: non-empty buckets migrated, and empty ones skipped at most.
+		 */
+		static const size_t MIGRATE_STEP = 4;
+		static const size_t EMPTY_VISITS = 40;
+
+		Node ** allocate_buckets(size_t n) {
+			if (n == 1) {
+				single_bucket = nullptr;
+				return &single_bucket;
+			}
+			return allocate_zeroed(alloc, n);
+		}
+
+		void deallocate_buckets(Node **table, size_t n) {
+			if (table && table != &single_bucket) alloc.deallocate(table, n);
+		}
+
+		bool migrating() const {
+			return draining.buckets != nullptr;
+		}
+
+		void push(bucket_array &array, Node *node) {
+			size_t idx = bucket_policy.index(node->hash, array.count);
+			node->hash_next = array.buckets[idx];
+			array.buckets[idx] = node;
+		}
+
+		bool unlink(bucket_array &array, Node *node) {
+			Node **curr_ptr = &array.buckets[bucket_policy.index(node->hash, array.count)];
+			while (*curr_ptr) {
+				if (*curr_ptr == node) {
+					*curr_ptr = node->hash_next;
+					return true;
+				}
+				curr_ptr = &((*curr_ptr)->hash_next);
+			}
+			return false;
+		}
+
+		/**
+		 * move up to steps non-empty buckets of draining into active.
+		 */
+		void migrate(size_t steps, size_t empty_visits) {
+			while (steps && migrated < draining.count) {
+				Node *curr = draining.buckets[migrated];
+				draining.buckets[migrated++] = nullptr;
+				if (!curr) {
+					if (--empty_visits == 0) break;
+					continue;
+				}
+				while (curr) {
+					Node *next = curr->hash_next;
+					push(active, curr);
+					curr = next;
+				}
+				--steps;
+			}
+			if (migrated == draining.count) {
+				deallocate_buckets(draining.buckets, draining.count);
+				draining.buckets = nullptr;
+				draining.count = 0;
+				migrated = 0;
+			}
+		}
+
+		void migrate_all() {
+			if (migrating()) migrate(draining.count, draining.count + 1);
+		}
+
+		void start_migration(size_t n) {
+			draining = active;
+			migrated = 0;
+			active.count = bucket_policy.bucket_count_for(n);
+			active.buckets = allocate_buckets(active.count);
+			migrate(MIGRATE_STEP, EMPTY_VISITS);
+		}
+
+	public:
+		explicit table(const Allocator &a = Allocator()) noexcept
+			: migrated(0), single_bucket(nullptr), max_load(0.75f), alloc(a) {
+			active.buckets = &single_bucket;
+			active.count = 1;
+			draining.buckets = nullptr;
+			draining.count = 0;
+		}
+		table(const table &) = delete;
+		table & operator=(const table &) = delete;
+
+		~table() {
+			deallocate_buckets(active.buckets, active.count);
+			deallocate_buckets(draining.buckets, draining.count);
+		}
+
+		const BucketPolicy & policy() const {
+			return bucket_policy;
+		}
+
+		void policy(const BucketPolicy &p) {
+			bucket_policy = p;
+		}
+
+		void swap(table &other) noexcept {
+			bool single = active.buckets == &single_bucket;
+			bool draining_single = draining.buckets == &single_bucket;
+			bool other_single = other.active.buckets == &other.single_bucket;
+			bool other_draining_single = other.draining.buckets == &other.single_bucket;
+			std::swap(active, other.active);
+			std::swap(draining, other.draining);
+			std::swap(migrated, other.migrated);
+			std::swap(single_bucket, other.single_bucket);
+			std::swap(max_load, other.max_load);
+			std::swap(bucket_policy, other.bucket_policy);
+			std::swap(alloc, other.alloc);
+			if (other_single) active.buckets = &single_bucket;
+			if (other_draining_single) draining.buckets = &single_bucket;
+			if (single) other.active.buckets = &other.single_bucket;
+			if (draining_single) other.draining.buckets = &other.single_bucket;
+		}
+
+		/**
+		 * the size of the array being filled, while migrating too.
+		 */
+		size_t bucket_count() const {
+			return active.count;
+		}
+
+		float max_load_factor() const {
+			return max_load;
+		}
+
+		void max_load_factor(float ml) {
+			max_load = ml;
+		}
+
+		template<class Pred>
+		Node* find(size_t hash, Pred pred) const {
+			for (Node *curr = active.buckets[bucket_policy.index(hash, active.count)]; curr; curr = curr->hash_next) {
+				if (curr->hash == hash && pred(curr)) {
+					return curr;
+				}
+			}
+			if (!migrating()) return nullptr;
+			for (Node *curr = draining.buckets[bucket_policy.index(hash, draining.count)]; curr; curr = curr->hash_next) {
+				if (curr->hash == hash && pred(curr)) {
+					return curr;
+				}
+			}
+			return nullptr;
+		}
+
+		void prefetch_bucket(size_t hash) const {
+			prefetch_address(active.buckets + bucket_policy.index(hash, active.count));
+		}
+
+		void prefetch_entry(size_t hash) const {
+			Node *head = active.buckets[bucket_policy.index(hash, active.count)];
+			if (head) prefetch_address(head);
+		}
+
+		void insert(Node *node) {
+			push(active, node);
+		}
+
+		void erase(Node *node) {
+			if (!unlink(active, node) && migrating()) unlink(draining, node);
+			if (migrating()) migrate(MIGRATE_STEP, EMPTY_VISITS);
+		}
+
+		/**
+		 * the buckets of both arrays while migrating; the drained ones are empty.
+		 */
+		template<class Visit>
+		void for_each_bucket(Visit visit) const {
+			const bucket_array *arrays[2] = {&active, &draining};
+			for (int a = 0; a < 2; ++a) {
+				for (size_t i = 0; arrays[a]->buckets && i < arrays[a]->count; ++i) {
+					size_t length = 0;
+					for (Node *curr = arrays[a]->buckets[i]; curr; curr = curr->hash_next) ++length;
+					visit(length);
+				}
+			}
+		}
+
+		template<class Visit>
+		void for_each_in(size_t part, size_t parts, Visit visit) const {
+			const bucket_array *arrays[2] = {&active, &draining};
+			for (int a = 0; a < 2; ++a) {
+				if (!arrays[a]->buckets) continue;
+				size_t end = slice_begin(arrays[a]->count, part + 1, parts);
+				for (size_t i = slice_begin(arrays[a]->count, part, parts); i < end; ++i) {
+					for (Node *curr = arrays[a]->buckets[i]; curr; curr = curr->hash_next) visit(curr);
+				}
+			}
+		}
+
+		void clear() {
+			for (size_t i = 0; i < active.count; ++i) {
+				active.buckets[i] = nullptr;
+			}
+			deallocate_buckets(draining.buckets, draining.count);
+			draining.buckets = nullptr;
+			draining.count = 0;
+			migrated = 0;
+		}
+
+		void rehash(size_t n) {
+			migrate_all();
+			bucket_array old = active;
+			Node *old_single = single_bucket;
+			if (old.buckets == &single_bucket) old.buckets = &old_single;
+
+			active.count = bucket_policy.bucket_count_for(n);
+			active.buckets = allocate_buckets(active.count);
+
+			for (size_t i = 0; i < old.count; ++i) {
+				Node *curr = old.buckets[i];
+				while (curr) {
+					Node *next = curr->hash_next;
+					push(active, curr);
+					curr = next;
+				}
+			}
+
+			if (old.buckets != &old_single) alloc.deallocate(old.buckets, old.count);
+		}
+
+		/**
+		 * make room for one more element, given the current number of elements.
+		 * a migration still running when the next growth is due is finished first.
+		 */
+		void prepare_insert(size_t size) {
+			if (migrating()) migrate(MIGRATE_STEP, EMPTY_VISITS);
+			if (size > active.count * max_load) {
+				migrate_all();
+				size_t target = active.count * 2 > MIN_BUCKET_COUNT ? active.count * 2 : MIN_BUCKET_COUNT;
+				size_t needed = static_cast<size_t>(size / max_load) + 1;
+				start_migration(target > needed ? target : needed);
+			}
+		}
+	};
+};
+
+    /**
+     * A group of control bytes of swiss_index, probed at once.
+     * SSE2 and NEON compare 16 bytes per instruction; elsewhere 8 bytes
+     * are compared inside a 64-bit word.
+     *
+     * A control byte is EMPTY, DELETED, or the low 7 bits of the hash of
+     * a full slot (always >= 0).
+     */
+struct swiss_group {
+	typedef signed char ctrl_t;
+
+	static const ctrl_t EMPTY = -128;
+	static const ctrl_t DELETED = -2;
+
+	/**
+	 * what an empty table probes: never written, never matched.
+	 */
+	static ctrl_t * empty_group() {
+		static ctrl_t group[16] = {
+			EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY,
+			EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY
+		};
+		return group;
+	}
+
+#if defined(__SSE2__)
+	static const size_t WIDTH = 16;
+	static const int SHIFT = 0;
+#elif defined(__ARM_NEON)
+	static const size_t WIDTH = 16;
+	static const int SHIFT = 2;
+#else
+	static const size_t WIDTH = 8;
+	static const int SHIFT = 3;
+#endif
+
+	/**
+	 * the lanes selected by a match, lowest lane first.
+	 */
+	class bitmask {
+	private:
+		unsigned long long mask;
+
+		static size_t lowest_bit(unsigned long long x) {
+#if defined(__GNUC__)
+			return __builtin_ctzll(x);
+#else
+			size_t result = 0;
+			while (!(x & 1)) {
+				x >>= 1;
+				++result;
+			}
+			return result;
+#endif
+		}
+
+		static size_t highest_bit(unsigned long long x) {
+#if defined(__GNUC__)
+			return 63 - __builtin_clzll(x);
+#else
+			size_t result = 0;
+			while (x >>= 1) ++result;
+			return result;
+#endif
+		}
+
+	public:
+		explicit bitmask(unsigned long long m) : mask(m) {}
+
+		explicit operator bool() const {
+			return mask != 0;
+		}
+
+		size_t lowest() const {
+			return lowest_bit(mask) >> SHIFT;
+		}
+
+		void clear_lowest() {
+			mask &= mask - 1;
+		}
+
+		size_t trailing_zeros() const {
+			return mask ? lowest() : WIDTH;
+		}
+
+		size_t leading_zeros() const {
+			return mask ? WIDTH - 1 - (highest_bit(mask) >> SHIFT) : WIDTH;
+		}
+	};
+
+#if defined(__SSE2__)
+	__m128i ctrl;
+
+	explicit swiss_group(const ctrl_t *pos) : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pos))) {}
+
+	bitmask match(ctrl_t h2) const {
+		return bitmask(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl))));
+	}
+
+	bitmask match_empty() const {
+		return match(EMPTY);
+	}
+
+	bitmask match_free() const {
+		return bitmask(static_cast<unsigned>(_mm_movemask_epi8(ctrl)));
+	}
+#elif defined(__ARM_NEON)
+	int8x16_t ctrl;
+
+	explicit swiss_group(const ctrl_t *pos) : ctrl(vld1q_s8(pos)) {}
+
+	static bitmask to_mask(uint8x16_t lanes) {
+		uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(lanes), 4);
+		return bitmask(vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & 0x8888888888888888ULL);
+	}
+
+	bitmask match(ctrl_t h2) const {
+		return to_mask(vceqq_s8(vdupq_n_s8(h2), ctrl));
+	}
+
+	bitmask match_empty() const {
+		return match(EMPTY);
+	}
+
+	bitmask match_free() const {
+		return to_mask(vcltq_s8(ctrl, vdupq_n_s8(0)));
+	}
+#else
+	unsigned long long ctrl;
+
+	static const unsigned long long LSBS = 0x0101010101010101ULL;
+	static const unsigned long long MSBS = 0x8080808080808080ULL;
+
+	explicit swiss_group(const ctrl_t *pos) {
+		memcpy(&ctrl, pos, sizeof(ctrl));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		ctrl = __builtin_bswap64(ctrl);
+#endif
+	}
+
+	/**
+	 * may report false positives, which the hash comparison filters out.
+	 */
+	bitmask match(ctrl_t h2) const {
+		unsigned long long x = ctrl ^ (LSBS * static_cast<unsigned char>(h2));
+		return bitmask((x - LSBS) & ~x & MSBS);
+	}
+
+	bitmask match_empty() const {
+		return bitmask(ctrl & ~(ctrl << 6) & MSBS);
+	}
+
+	bitmask match_free() const {
+		return bitmask(ctrl & MSBS);
+	}
+#endif
+};
+
+    /**
+     * open addressing in the style of Swiss tables: a flat array of node
+     * pointers and one control byte per slot, probed a group at a time.
+     * A lookup touches one or two cache lines of control bytes and only
+     * dereferences nodes whose 7-bit hash tag matches.
+     * Needs a power-of-two BucketPolicy.
+     * An empty table points at a shared group of EMPTY bytes and allocates
+     * on the first insert.
+     */
+struct swiss_index {
+	template<class Node>
+	struct hook {};
+
+	template<class Node, class BucketPolicy, class Allocator>
+	class table {
+	private:
+		typedef swiss_group::ctrl_t ctrl_t;
+		typedef typename rebind_alloc<Allocator, char>::type byte_allocator;
+
+		static_assert(BucketPolicy::power_of_two, "swiss_index needs power-of-two bucket counts");
+
+		static const size_t WIDTH = swiss_group::WIDTH;
+
+		ctrl_t *ctrl;
+		Node **slots;
+		size_t capacity;
+		size_t used;
+		size_t deleted;
+		float max_load;
+		BucketPolicy bucket_policy;
+		byte_allocator alloc;
+
+		static constexpr float MAX_LOAD_FACTOR = 0.875f;
+
+		static size_t h1(size_t hash) {
+			return hash >> 7;
+		}
+
+		static ctrl_t h2(size_t hash) {
+			return static_cast<ctrl_t>(hash & 0x7f);
+		}
+
+		/**
+		 * at least one slot always stays EMPTY, so every probe terminates.
+		 */
+		size_t max_used(size_t cap) const {
+			size_t result = static_cast<size_t>(cap * max_load);
+			return result < cap ? result : cap - 1;
+		}
+
+		static size_t bytes_for(size_t cap) {
+			return cap * sizeof(Node *) + cap + WIDTH;
+		}
+
+		/**
+		 * triangular probing over groups, which visits every group
+		 * of a power-of-two table.
+		 */
+		struct probe {
+			size_t pos;
+			size_t step;
+			size_t mask;
+
+			probe(size_t hash, size_t cap) : pos(h1(hash) & (cap - 1)), step(0), mask(cap - 1) {}
+
+			void next() {
+				step += WIDTH;
+				pos = (pos + step) & mask;
+			}
+		};
+
+		/**
+		 * the first WIDTH control bytes are mirrored behind the last one,
+		 * so a group can be loaded from any position.
+		 */
+		void set_ctrl(size_t i, ctrl_t value) {
+			ctrl[i] = value;
+			if (i < WIDTH) ctrl[i + capacity] = value;
+		}
+
+		size_t find_free(size_t hash) const {
+			probe p(hash, capacity);
+			while (true) {
+				swiss_group::bitmask free = swiss_group(ctrl + p.pos).match_free();
+				if (free) return (p.pos + free.lowest()) & p.mask;
+				p.next();
+			}
+		}
+
+		void allocate(size_t cap) {
+			capacity = cap;
+			char *raw = alloc.allocate(bytes_for(capacity));
+			slots = reinterpret_cast<Node **>(raw);
+			ctrl = reinterpret_cast<ctrl_t *>(raw + capacity * sizeof(Node *));
+			memset(ctrl, swiss_group::EMPTY, capacity + WIDTH);
+			used = 0;
+			deleted = 0;
+		}
+
+
+		size_t legal_capacity(size_t n) const {
+			size_t cap = bucket_policy.bucket_count_for(n < WIDTH ? WIDTH : n);
+			while (max_used(cap) <= used) cap *= 2;
+			return cap;
+		}
+
+	public:
+		explicit table(const Allocator &a = Allocator()) noexcept
+			: ctrl(swiss_group::empty_group()), slots(nullptr), capacity(1), used(0), deleted(0),
+			  max_load(MAX_LOAD_FACTOR), alloc(a) {}
+		table(const table &) = delete;
+		table & operator=(const table &) = delete;
+
+		~table() {
+			if (slots) alloc.deallocate(reinterpret_cast<char *>(slots), bytes_for(capacity));
+		}
+
+		const BucketPolicy & policy() const {
+			return bucket_policy;
+		}
+
+		void policy(const BucketPolicy &p) {
+			bucket_policy = p;
+		}
+
+		void swap(table &other) noexcept {
+			std::swap(ctrl, other.ctrl);
+			std::swap(slots, other.slots);
+			std::swap(capacity, other.capacity);
+			std::swap(used, other.used);
+			std::swap(deleted, other.deleted);
+			std::swap(max_load, other.max_load);
+			std::swap(bucket_policy, other.bucket_policy);
+			std::swap(alloc, other.alloc);
+		}
+
+		size_t bucket_count() const {
+			return capacity;
+		}
+
+		float max_load_factor() const {
+			return max_load;
+		}
+
+		/**
+		 * beyond 7/8 probe sequences get long, so larger factors are clamped.
+		 */
+		void max_load_factor(float ml) {
+			max_load = ml < MAX_LOAD_FACTOR ? ml : MAX_LOAD_FACTOR;
+		}
+
+		template<class Pred>
+		Node* find(size_t hash, Pred pred) const {
+			probe p(hash, capacity);
+			ctrl_t tag = h2(hash);
+			prefetch_address(slots + p.pos);
+			while (true) {
+				swiss_group group(ctrl + p.pos);
+				for (swiss_group::bitmask match = group.match(tag); match; match.clear_lowest()) {
+					Node *node = slots[(p.pos + match.lowest()) & p.mask];
+					if (node->hash == hash && pred(node)) {
+						return node;
+					}
+				}
+				if (group.match_empty()) return nullptr;
+				p.next();
+			}
+		}
+
+		void prefetch_bucket(size_t hash) const {
+			probe p(hash, capacity);
+			prefetch_address(ctrl + p.pos);
+			prefetch_address(slots + p.pos);
+		}
+
+		/**
+		 * the node behind the first tag match in the first group.
+		 */
+		void prefetch_entry(size_t hash) const {
+			probe p(hash, capacity);
+			swiss_group::bitmask match = swiss_group(ctrl + p.pos).match(h2(hash));
+			if (match) prefetch_address(slots[(p.pos + match.lowest()) & p.mask]);
+		}
+
+		void insert(Node *node) {
+			size_t i = find_free(node->hash);
+			if (ctrl[i] == swiss_group::DELETED) --deleted;
+			set_ctrl(i, h2(node->hash));
+			slots[i] = node;
+			++used;
+		}
+
+		/**
+		 * a slot becomes EMPTY again only if no probe sequence can have
+		 * passed over it while it was full, otherwise it turns DELETED.
+		 */
+		void erase(Node *node) {
+			probe p(node->hash, capacity);
+			ctrl_t tag = h2(node->hash);
+			while (true) {
+				for (swiss_group::bitmask match = swiss_group(ctrl + p.pos).match(tag); match; match.clear_lowest()) {
+					size_t i = (p.pos + match.lowest()) & p.mask;
+					if (slots[i] != node) continue;
+					swiss_group::bitmask empty_after = swiss_group(ctrl + i).match_empty();
+					swiss_group::bitmask empty_before = swiss_group(ctrl + ((i - WIDTH) & p.mask)).match_empty();
+					bool never_full = empty_before && empty_after &&
+						empty_after.trailing_zeros() + empty_before.leading_zeros() < WIDTH;
+					set_ctrl(i, never_full ? swiss_group::EMPTY : swiss_group::DELETED);
+					if (!never_full) ++deleted;
+					--used;
+					return;
+				}
+				p.next();
+			}
+		}
+
+		/**
+		 * a bucket is a group of WIDTH slots here, and its entries the full ones.
+		 */
+		template<class Visit>
+		void for_each_bucket(Visit visit) const {
+			for (size_t base = 0; slots && base < capacity; base += WIDTH) {
+				size_t full = 0;
+				for (size_t i = base; i < base + WIDTH && i < capacity; ++i) {
+					if (ctrl[i] >= 0) ++full;
+				}
+				visit(full);
+			}
+		}
+
+		template<class Visit>
+		void for_each_in(size_t part, size_t parts, Visit visit) const {
+			if (!slots) return;
+			for (size_t i = slice_begin(capacity, part, parts); i < slice_begin(capacity, part + 1, parts); ++i) {
+				if (ctrl[i] >= 0) visit(slots[i]);
+			}
+		}
+
+		void clear() {
+			if (!slots) return;
+			memset(ctrl, swiss_group::EMPTY, capacity + WIDTH);
+			used = 0;
+			deleted = 0;
+		}
+
+		void rehash(size_t n) {
+			ctrl_t *old_ctrl = ctrl;
+			Node **old_slots = slots;
+			size_t old_capacity = capacity;
+
+			if (n == 0 && used == 0) {
+				ctrl = swiss_group::empty_group();
+				slots = nullptr;
+				capacity = 1;
+				deleted = 0;
+			} else {
+				allocate(legal_capacity(n));
+			}
+			for (size_t i = 0; old_slots && i < old_capacity; ++i) {
+				if (old_ctrl[i] >= 0) insert(old_slots[i]);
+			}
+
+			if (old_slots) alloc.deallocate(reinterpret_cast<char *>(old_slots), bytes_for(old_capacity));
+		}
+
+		/**
+		 * once no EMPTY slot may be used any more, either squeeze the
+		 * DELETED ones out at the same size or grow.
+		 */
+		void prepare_insert(size_t) {
+			if (used + deleted < max_used(capacity)) return;
+			if (used * 28 <= max_used(capacity) * 25) {
+				rehash(capacity);
+			} else {
+				rehash(capacity * 2);
+			}
+		}
+	};
+};
+
+    /**
+     * whether Equal holds for two Keys exactly when their bytes are equal,
+     * so that integer_key_index may compare the bytes itself.
+     * True for std::equal_to on integers, enums and pointers; specialize it
+     * for other trivially copyable keys whose Equal compares every byte.
+     */
+template<class Key, class Equal>
+struct bitwise_equal : std::integral_constant<bool,
+	(std::is_integral<Key>::value || std::is_enum<Key>::value || std::is_pointer<Key>::value) &&
+	(std::is_same<Equal, std::equal_to<Key> >::value || std::is_same<Equal, std::equal_to<> >::value)> {};
+
+    /**
+     * swiss_index for small trivially copyable keys (4 or 8 bytes, like
+     * int, long long or a pointer): next to the control bytes it keeps a
+     * copy of every key in a dense array, so that a lookup checks the
+     * slots whose hash tag matches against that array, and dereferences
+     * no node and calls no Equal, not even on a false tag match.
+     * The key array is only trusted where bitwise_equal<Key, Equal> holds
+     * and the key looked up has the Key type; other lookups (heterogeneous
+     * or with a custom Equal) compare nodes as swiss_index does.
+     * A slot costs sizeof(Key) more than in swiss_index.
+     * Needs a power-of-two BucketPolicy.
+     */
+struct integer_key_index {
+	template<class Node>
+	struct hook {};
+
+	template<class Node, class BucketPolicy, class Allocator>
+	class table {
+	private:
+		typedef swiss_group::ctrl_t ctrl_t;
+		typedef typename rebind_alloc<Allocator, char>::type byte_allocator;
+		typedef typename std::decay<decltype(std::declval<const Node &>().data.first)>::type key_type;
+
+		static_assert(BucketPolicy::power_of_two, "integer_key_index needs power-of-two bucket counts");
+		static_assert(std::is_trivially_copyable<key_type>::value && (sizeof(key_type) == 4 || sizeof(key_type) == 8),
+			"integer_key_index needs trivially copyable keys of 4 or 8 bytes (see auto_index)");
+
+		typedef typename std::conditional<sizeof(key_type) == 4, unsigned int, unsigned long long>::type word;
+
+		static const size_t WIDTH = swiss_group::WIDTH;
+
+		word *keys;
+		Node **slots;
+		ctrl_t *ctrl;
+		size_t capacity;
+		size_t used;
+		size_t deleted;
+		float max_load;
+		BucketPolicy bucket_policy;
+		byte_allocator alloc;
+
+		static constexpr float MAX_LOAD_FACTOR = 0.875f;
+
+		static size_t h1(size_t hash) {
+			return hash >> 7;
+		}
+
+		static ctrl_t h2(size_t hash) {
+			return static_cast<ctrl_t>(hash & 0x7f);
+		}
+
+		static word word_of(const key_type &key) {
+			word result;
+			memcpy(&result, &key, sizeof(word));
+			return result;
+		}
+
+		size_t max_used(size_t cap) const {
+			size_t result = static_cast<size_t>(cap * max_load);
+			return result < cap ? result : cap - 1;
+		}
+
+		/**
+		 * keys, then nodes, then control bytes: the keys and the control
+		 * bytes have WIDTH mirrored entries behind the last slot.
+		 */
+		static size_t bytes_for(size_t cap) {
+			return (cap + WIDTH) * sizeof(word) + cap * sizeof(Node *) + cap + WIDTH;
+		}
+
+		struct probe {
+			size_t pos;
+			size_t step;
+			size_t mask;
+
+			probe(size_t hash, size_t cap) : pos(h1(hash) & (cap - 1)), step(0), mask(cap - 1) {}
+
+			void next() {
+				step += WIDTH;
+				pos = (pos + step) & mask;
+			}
+		};
+
+		void set_slot(size_t i, ctrl_t value, word key) {
+			ctrl[i] = value;
+			keys[i] = key;
+			if (i < WIDTH) {
+				ctrl[i + capacity] = value;
+				keys[i + capacity] = key;
+			}
+		}
+
+		void set_ctrl(size_t i, ctrl_t value) {
+			ctrl[i] = value;
+			if (i < WIDTH) ctrl[i + capacity] = value;
+		}
+
+		size_t find_free(size_t hash) const {
+			probe p(hash, capacity);
+			while (true) {
+				swiss_group::bitmask free = swiss_group(ctrl + p.pos).match_free();
+				if (free) return (p.pos + free.lowest()) & p.mask;
+				p.next();
+			}
+		}
+
+		/**
+		 * the keys of free slots are left stale: their control bytes never
+		 *   match a tag, so they are never read.
+		 */
+		void allocate(size_t cap) {
+			capacity = cap;
+			char *raw = alloc.allocate(bytes_for(capacity));
+			keys = reinterpret_cast<word *>(raw);
+			slots = reinterpret_cast<Node **>(raw + (capacity + WIDTH) * sizeof(word));
+			ctrl = reinterpret_cast<ctrl_t *>(raw + (capacity + WIDTH) * sizeof(word) + capacity * sizeof(Node *));
+			memset(ctrl, swiss_group::EMPTY, capacity + WIDTH);
+			used = 0;
+			deleted = 0;
+		}
+
+		size_t legal_capacity(size_t n) const {
+			size_t cap = bucket_policy.bucket_count_for(n < WIDTH ? WIDTH : n);
+			while (max_used(cap) <= used) cap *= 2;
+			return cap;
+		}
+
+		template<class Pred>
+		Node* find(size_t hash, const Pred &pred, std::true_type) const {
+			probe p(hash, capacity);
+			word wanted = word_of(pred.key);
+			while (true) {
+				swiss_group group(ctrl + p.pos);
+				for (swiss_group::bitmask match = group.match(h2(hash)); match; match.clear_lowest()) {
+					size_t i = p.pos + match.lowest();
+					if (keys[i] == wanted) return slots[i & p.mask];
+				}
+				if (group.match_empty()) return nullptr;
+				p.next();
+			}
+		}
+
+		template<class Pred>
+		Node* find(size_t hash, const Pred &pred, std::false_type) const {
+			probe p(hash, capacity);
+			ctrl_t tag = h2(hash);
+			while (true) {
+				swiss_group group(ctrl + p.pos);
+				for (swiss_group::bitmask match = group.match(tag); match; match.clear_lowest()) {
+					Node *node = slots[(p.pos + match.lowest()) & p.mask];
+					if (node->hash == hash && pred(node)) {
+						return node;
+					}
+				}
+				if (group.match_empty()) return nullptr;
+				p.next();
+			}
+		}
+
+	public:
+		explicit table(const Allocator &a = Allocator()) noexcept
+			: keys(nullptr), slots(nullptr), ctrl(swiss_group::empty_group()), capacity(1), used(0), deleted(0),
+			  max_load(MAX_LOAD_FACTOR), alloc(a) {}
+		table(const table &) = delete;
+		table & operator=(const table &) = delete;
+
+		~table() {
+			if (slots) alloc.deallocate(reinterpret_cast<char *>(keys), bytes_for(capacity));
+		}
+
+		const BucketPolicy & policy() const {
+			return bucket_policy;
+		}
+
+		void policy(const BucketPolicy &p) {
+			bucket_policy = p;
+		}
+
+		void swap(table &other) noexcept {
+			std::swap(keys, other.keys);
+			std::swap(slots, other.slots);
+			std::swap(ctrl, other.ctrl);
+			std::swap(capacity, other.capacity);
+			std::swap(used, other.used);
+			std::swap(deleted, other.deleted);
+			std::swap(max_load, other.max_load);
+			std::swap(bucket_policy, other.bucket_policy);
+			std::swap(alloc, other.alloc);
+		}
+
+		size_t bucket_count() const {
+			return capacity;
+		}
+
+		float max_load_factor() const {
+			return max_load;
+		}
+
+		void max_load_factor(float ml) {
+			max_load = ml < MAX_LOAD_FACTOR ? ml : MAX_LOAD_FACTOR;
+		}
+
+		template<class Pred>
+		Node* find(size_t hash, Pred pred) const {
+			return find(hash, pred, std::integral_constant<bool,
+				std::is_same<typename Pred::key_type, key_type>::value &&
+				bitwise_equal<key_type, typename Pred::equal_type>::value>());
+		}
+
+		void prefetch_bucket(size_t hash) const {
+			probe p(hash, capacity);
+			prefetch_address(ctrl + p.pos);
+			if (keys) prefetch_address(keys + p.pos);
+		}
+
+		/**
+		 * a key lookup needs no node; this is for the other ones.
+		 */
+		void prefetch_entry(size_t hash) const {
+			probe p(hash, capacity);
+			swiss_group::bitmask match = swiss_group(ctrl + p.pos).match(h2(hash));
+			if (match) prefetch_address(slots[(p.pos + match.lowest()) & p.mask]);
+		}
+
+		void insert(Node *node) {
+			size_t i = find_free(node->hash);
+			if (ctrl[i] == swiss_group::DELETED) --deleted;
+			set_slot(i, h2(node->hash), word_of(node->data.first));
+			slots[i] = node;
+			++used;
+		}
+
+		void erase(Node *node) {
+			probe p(node->hash, capacity);
+			ctrl_t tag = h2(node->hash);
+			while (true) {
+				for (swiss_group::bitmask match = swiss_group(ctrl + p.pos).match(tag); match; match.clear_lowest()) {
+					size_t i = (p.pos + match.lowest()) & p.mask;
+					if (slots[i] != node) continue;
+					swiss_group::bitmask empty_after = swiss_group(ctrl + i).match_empty();
+					swiss_group::bitmask empty_before = swiss_group(ctrl + ((i - WIDTH) & p.mask)).match_empty();
+					bool never_full = empty_before && empty_after &&
+						empty_after.trailing_zeros() + empty_before.leading_zeros() < WIDTH;
+					set_ctrl(i, never_full ? swiss_group::EMPTY : swiss_group::DELETED);
+					if (!never_full) ++deleted;
+					--used;
+					return;
+				}
+				p.next();
+			}
+		}
+
+		template<class Visit>
+		void for_each_bucket(Visit visit) const {
+			for (size_t base = 0; slots && base < capacity; base += WIDTH) {
+				size_t full = 0;
+				for (size_t i = base; i < base + WIDTH && i < capacity; ++i) {
+					if (ctrl[i] >= 0) ++full;
+				}
+				visit(full);
+			}
+		}
+
+		template<class Visit>
+		void for_each_in(size_t part, size_t parts, Visit visit) const {
+			if (!slots) return;
+			for (size_t i = slice_begin(capacity, part, parts); i < slice_begin(capacity, part + 1, parts); ++i) {
+				if (ctrl[i] >= 0) visit(slots[i]);
+			}
+		}
+
+		void clear() {
+			if (!slots) return;
+			memset(ctrl, swiss_group::EMPTY, capacity + WIDTH);
+			used = 0;
+			deleted = 0;
+		}
+
+		void rehash(size_t n) {
+			word *old_keys = keys;
+			ctrl_t *old_ctrl = ctrl;
+			Node **old_slots = slots;
+			size_t old_capacity = capacity;
+
+			if (n == 0 && used == 0) {
+				keys = nullptr;
+				slots = nullptr;
+				ctrl = swiss_group::empty_group();
+				capacity = 1;
+				deleted = 0;
+			} else {
+				allocate(legal_capacity(n));
+			}
+			for (size_t i = 0; old_slots && i < old_capacity; ++i) {
+				if (old_ctrl[i] >= 0) insert(old_slots[i]);
+			}
+
+			if (old_slots) alloc.deallocate(reinterpret_cast<char *>(old_keys), bytes_for(old_capacity));
+		}
+
+		void prepare_insert(size_t) {
+			if (used + deleted < max_used(capacity)) return;
+			if (used * 28 <= max_used(capacity) * 25) {
+				rehash(capacity);
+			} else {
+				rehash(capacity * 2);
+			}
+		}
+	};
+};
+
+    /**
+     * the IndexPolicy picked at compile time from the key type:
+     * integer_key_index for trivially copyable keys of 4 or 8 bytes,
+     * chained_index otherwise, as in
+     *   linked_hashmap<Key, T, Hash, Equal, Allocator, BucketPolicy, auto_index<Key> >
+     * chained_index stays the default of linked_hashmap, so existing maps
+     * keep its bucket counts and unbounded load factors.
+     */
+template<class Key>
+struct auto_index : std::conditional<std::is_trivially_copyable<Key>::value && (sizeof(Key) == 4 || sizeof(Key) == 8),
+	integer_key_index, chained_index>::type {};
+
+    /**
+     * small-buffer mode for maps that mostly stay tiny: up to N nodes are
+     * indexed by an array inside the table, found by a linear scan of
+     * 8-bit hash tags, so such a map never allocates a bucket array.
+     * The insert that would make it N + 1 moves the nodes into Inner, which
+     * then serves the table for good (clear() keeps it, as it keeps buckets).
+     * bucket_count() is N before that.
+     */
+template<size_t N = 8, class Inner = chained_index>
+struct small_index {
+	static_assert(N > 0 && N <= 64, "small_index scans at most 64 entries");
+
+	template<class Node>
+	using hook = typename Inner::template hook<Node>;
+
+	template<class Node, class BucketPolicy, class Allocator>
+	class table {
+	private:
+		typedef typename Inner::template table<Node, BucketPolicy, Allocator> large_table;
+
+		Node *small[N];
+		unsigned char tags[N];
+		size_t small_count;
+		bool large;
+		large_table big;
+
+		static unsigned char tag(size_t hash) {
+			return static_cast<unsigned char>(hash);
+		}
+
+		/**
+		 * move the small entries into big, sized for n.
+		 */
+		void spill(size_t n) {
+			big.rehash(n);
+			for (size_t i = 0; i < small_count; ++i) big.insert(small[i]);
+			small_count = 0;
+			large = true;
+		}
+
+	public:
+		explicit table(const Allocator &a = Allocator()) noexcept : small_count(0), large(false), big(a) {}
+		table(const table &) = delete;
+		table & operator=(const table &) = delete;
+
+		const BucketPolicy & policy() const {
+			return big.policy();
+		}
+
+		void policy(const BucketPolicy &p) {
+			big.policy(p);
+		}
+
+		void swap(table &other) noexcept {
+			for (size_t i = 0; i < N; ++i) {
+				std::swap(small[i], other.small[i]);
+				std::swap(tags[i], other.tags[i]);
+			}
+			std::swap(small_count, other.small_count);
+			std::swap(large, other.large);
+			big.swap(other.big);
+		}
+
+		size_t bucket_count() const {
+			return large ? big.bucket_count() : N;
+		}
+
+		float max_load_factor() const {
+			return big.max_load_factor();
+		}
+
+		void max_load_factor(float ml) {
+			big.max_load_factor(ml);
+		}
+
+		template<class Pred>
+		Node* find(size_t hash, Pred pred) const {
+			if (large) return big.find(hash, pred);
+			unsigned char wanted = tag(hash);
+			for (size_t i = 0; i < small_count; ++i) {
+				if (tags[i] == wanted && small[i]->hash == hash && pred(small[i])) return small[i];
+			}
+			return nullptr;
+		}
+
+		/**
+		 * the small entries sit in the table, next to the map.
+		 */
+		void prefetch_bucket(size_t hash) const {
+			if (large) big.prefetch_bucket(hash);
+		}
+
+		void prefetch_entry(size_t hash) const {
+			if (large) big.prefetch_entry(hash);
+		}
+
+		void insert(Node *node) {
+			if (!large && small_count == N) spill(N + 1);
+			if (large) {
+				big.insert(node);
+				return;
+			}
+			small[small_count] = node;
+			tags[small_count] = tag(node->hash);
+			++small_count;
+		}
+
+		/**
+		 * the last entry fills the hole.
+		 */
+		void erase(Node *node) {
+			if (large) {
+				big.erase(node);
+				return;
+			}
+			for (size_t i = 0; i < small_count; ++i) {
+				if (small[i] != node) continue;
+				--small_count;
+				small[i] = small[small_count];
+				tags[i] = tags[small_count];
+				return;
+			}
+		}
+
+		/**
+		 * the small array counts as one bucket.
+		 */
+		template<class Visit>
+		void for_each_bucket(Visit visit) const {
+			if (large) {
+				big.for_each_bucket(visit);
+			} else {
+				visit(small_count);
+			}
+		}
+
+		template<class Visit>
+		void for_each_in(size_t part, size_t parts, Visit visit) const {
+			if (large) {
+				big.for_each_in(part, parts, visit);
+			} else if (part == 0) {
+				for (size_t i = 0; i < small_count; ++i) visit(small[i]);
+			}
+		}
+
+		void clear() {
+			small_count = 0;
+			big.clear();
+		}
+
+		void rehash(size_t n) {
+			if (large) {
+				big.rehash(n);
+			} else if (n > N) {
+				spill(n);
+			}
+		}
+
+		void prepare_insert(size_t size) {
+			if (!large && size >= N) spill(size + 1);
+			if (large) big.prepare_insert(size);
+		}
+	};
+};
+
+    /**
+     * Order policies of linked_hashmap: an optional layer over the
+     * insertion-order list. A policy provides hook<Node> (fields inside
+     * every node) and table<Node>, which the map tells about every change
+     * to the list: insert_before(node, position), position being nullptr
+     * for the end, erase(node), clear() and swap().
+     */
+
+    /**
+     * nothing but the list: the default, with no fields and no work.
+     */
+struct unranked_order {
+	static const bool ranked = false;
+
+	template<class Node>
+	struct hook {};
+
+	template<class Node>
+	class table {
+	public:
+		void insert_before(Node *, Node *) {}
+		void erase(Node *) {}
+		void clear() {}
+		void swap(table &) noexcept {}
+	};
+};
+
+    /**
+     * the list mirrored by an implicit treap: an in-order traversal gives
+     * the insertion order, and every node counts the nodes below it, so
+     * the k-th element and the position of an element are found in
+     * O(log n) expected, and every change to the list costs O(log n) too.
+     * It costs five words per node.
+     */
+struct ranked_order {
+	static const bool ranked = true;
+
+	template<class Node>
+	struct hook {
+		Node *rank_left;
+		Node *rank_right;
+		Node *rank_parent;
+		size_t rank_size;
+		size_t rank_priority;
+	};
+
+	template<class Node>
+	class table {
+	private:
+		Node *root;
+		unsigned long long state;
+
+		static size_t size_of(const Node *node) {
+			return node ? node->rank_size : 0;
+		}
+
+		static void update(Node *node) {
+			node->rank_size = 1 + size_of(node->rank_left) + size_of(node->rank_right);
+		}
+
+		/**
+		 * xorshift: the priorities only have to be unrelated to the order.
+		 */
+		size_t next_priority() {
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			return static_cast<size_t>(state);
+		}
+
+		void replace_child(Node *parent, Node *from, Node *to) {
+			if (!parent) {
+				root = to;
+			} else if (parent->rank_left == from) {
+				parent->rank_left = to;
+			} else {
+				parent->rank_right = to;
+			}
+			if (to) to->rank_parent = parent;
+		}
+
+		/**
+		 * rotate node above its parent, keeping the in-order sequence.
+		 */
+		void rotate_up(Node *node) {
+			Node *parent = node->rank_parent;
+			replace_child(parent->rank_parent, parent, node);
+			if (parent->rank_left == node) {
+				parent->rank_left = node->rank_right;
+				if (node->rank_right) node->rank_right->rank_parent = parent;
+				node->rank_right = parent;
+			} else {
+				parent->rank_right = node->rank_left;
+				if (node->rank_left) node->rank_left->rank_parent = parent;
+				node->rank_left = parent;
+			}
+			parent->rank_parent = node;
+			update(parent);
+			update(node);
+		}
+
+		static Node * rightmost(Node *node) {
+			while (node->rank_right) node = node->rank_right;
+			return node;
+		}
+
+	public:
+		table() noexcept : root(nullptr), state(0x9e3779b97f4a7c15ULL) {}
+
+		void insert_before(Node *node, Node *position) {
+			node->rank_left = node->rank_right = nullptr;
+			node->rank_size = 1;
+			node->rank_priority = next_priority();
+			if (!root) {
+				node->rank_parent = nullptr;
+				root = node;
+				return;
+			}
+			Node *parent;
+			if (!position) {
+				parent = rightmost(root);
+				parent->rank_right = node;
+			} else if (!position->rank_left) {
+				parent = position;
+				parent->rank_left = node;
+			} else {
+				parent = rightmost(position->rank_left);
+				parent->rank_right = node;
+			}
+			node->rank_parent = parent;
+			for (Node *curr = parent; curr; curr = curr->rank_parent) ++curr->rank_size;
+			while (node->rank_parent && node->rank_parent->rank_priority < node->rank_priority) rotate_up(node);
+		}
+
+		/**
+		 * rotate node down to a leaf, then cut it off.
+		 */
+		void erase(Node *node) {
+			while (node->rank_left || node->rank_right) {
+				Node *child = node->rank_left;
+				if (!child || (node->rank_right && node->rank_right->rank_priority > child->rank_priority)) {
+					child = node->rank_right;
+				}
+				rotate_up(child);
+			}
+			Node *parent = node->rank_parent;
+			replace_child(parent, node, nullptr);
+			for (Node *curr = parent; curr; curr = curr->rank_parent) --curr->rank_size;
+		}
+
+		void clear() {
+			root = nullptr;
+		}
+
+		void swap(table &other) noexcept {
+			std::swap(root, other.root);
+			std::swap(state, other.state);
+		}
+
+		/**
+		 * k < the number of nodes.
+		 */
+		Node * nth(size_t k) const {
+			Node *curr = root;
+			while (true) {
+				size_t left = size_of(curr->rank_left);
+				if (k < left) {
+					curr = curr->rank_left;
+				} else if (k == left) {
+					return curr;
+				} else {
+					k -= left + 1;
+					curr = curr->rank_right;
+				}
+			}
+		}
+
+		size_t position_of(const Node *node) const {
+			size_t result = size_of(node->rank_left);
+			for (const Node *curr = node; curr->rank_parent; curr = curr->rank_parent) {
+				if (curr->rank_parent->rank_right == curr) result += size_of(curr->rank_parent->rank_left) + 1;
+			}
+			return result;
+		}
+	};
+};
+
     /**
      * In linked_hashmap, iteration ordering is differ from map,
      * which is the order in which keys were inserted into the map.
@@ -19,86 +2278,296 @@ namespace sjtu {
      *
      * Note that insertion order is not affected if a key is re-inserted
      * into the map.
+     *
+     * For use as an LRU cache, touch() moves an element to the back in O(1),
+     * pop_front() drops the oldest one, and set_capacity() makes inserts
+     * evict from the front once the map is full.
      */
     
 template<
 	class Key,
 	class T,
 	class Hash = std::hash<Key>, 
-	class Equal = std::equal_to<Key>
+	class Equal = std::equal_to<Key>,
+	class Allocator = pool_allocator<pair<const Key, T> >,
+	class BucketPolicy = pow2_mix_bucket,
+	class IndexPolicy = chained_index,
+	class OrderPolicy = unranked_order
 > class linked_hashmap {
 public:
 	/**
-	 * the internal type of data.
-	 * it should have a default constructor, a copy constructor.
-	 * You can use sjtu::linked_hashmap as value_type by typedef.
+	 * the internal type of data.
+	 * it should have a default constructor, a copy constructor.
+	 * You can use sjtu::linked_hashmap as value_type by typedef.
+	 */
+	typedef pair<const Key, T> value_type;
+	typedef Allocator allocator_type;
+
+	/**
+	 * whether ++ and -- of the iterators throw invalid_iterator when they
+	 *   would leave [begin(), end()]. Defining SJTU_UNCHECKED_ITERATORS
+	 *   turns the checks off, so that each step is a single pointer load
+	 *   and stepping past either end is undefined.
+	 */
+#if defined(SJTU_UNCHECKED_ITERATORS)
+	static const bool checked_iterators = false;
+#else
+	static const bool checked_iterators = true;
+#endif
+
+private:
+	/**
+	 * the links of the insertion-order list.
+	 * head and tail are bare NodeBases inside the map, so they carry no key
+	 *   or value and an empty map needs no allocation.
+	 */
+	struct NodeBase {
+		NodeBase *prev;
+		NodeBase *next;
+
+		NodeBase() : prev(nullptr), next(nullptr) {}
+	};
+
+	/**
+	 * selects the Node constructor that builds the mapped value from the
+	 *   arguments after the key, as try_emplace needs.
+	 */
+	struct mapped_args_tag {};
+
+	/**
+	 * an element: the pair lives inline, right behind the links,
+	 * so a chain walk or an ordered scan touches one allocation per element.
+	 * the full hash of the key is kept, so it is computed once per element.
+	 */
+	struct Node : NodeBase, IndexPolicy::template hook<Node>, OrderPolicy::template hook<Node> {
+		typedef Equal equal_type;
+
+		size_t hash;
+		value_type data;
+
+		template<class... Args>
+		Node(size_t h, Args&&... args) : hash(h), data(std::forward<Args>(args)...) {}
+
+		template<class K, class... Args>
+		Node(size_t h, mapped_args_tag, K &&key, Args&&... args)
+			: hash(h), data(std::forward<K>(key), T(std::forward<Args>(args)...)) {}
+	};
+
+	typedef typename rebind_alloc<Allocator, Node>::type node_allocator;
+	typedef typename IndexPolicy::template table<Node, BucketPolicy, Allocator> index_table;
+	typedef typename OrderPolicy::template table<Node> order_table;
+	
+	NodeBase head;
+	NodeBase tail;
+	size_t element_count;
+	Hash hash_func;
+	Equal equal_func;
+	node_allocator node_alloc;
+	index_table index;
+	order_table order;
+	size_t capacity_limit;
+	std::function<void(pair<const Key, T> &)> on_evict;
+
+	void init_sentinels() {
+		head.next = &tail;
+		tail.prev = &head;
+	}
+
+	/**
+	 * makes the chain first..last (taken from another map, whose own
+	 *   sentinels it may still point at) the list of this map.
+	 * first == nullptr stands for an empty chain.
+	 */
+	void adopt_list(NodeBase *first, NodeBase *last) {
+		if (!first) {
+			init_sentinels();
+			return;
+		}
+		head.next = first;
+		first->prev = &head;
+		tail.prev = last;
+		last->next = &tail;
+	}
+
+	static Node* as_node(NodeBase *node) {
+		return static_cast<Node *>(node);
+	}
+
+	template<class... Args>
+	Node* create_node(size_t hash, Args&&... args) {
+		Node *node = node_alloc.allocate(1);
+		SJTU_TRY {
+			new (node) Node(hash, std::forward<Args>(args)...);
+		} SJTU_CATCH_ALL {
+			node_alloc.deallocate(node, 1);
+			SJTU_RETHROW;
+		}
+		return node;
+	}
+
+	void destroy_node(Node *node) {
+		node->~Node();
+		node_alloc.deallocate(node, 1);
+	}
+	
+	template<class K>
+	size_t hash_of(const K &key) const {
+		return index.policy().mix(hash_func(key));
+	}
+	
+	void check_and_rehash() {
+		index.prepare_insert(element_count);
+	}
+	
+	template<class K>
+	Node* find_node(const K &key) const {
+		return find_node(key, hash_of(key));
+	}
+
+	/**
+	 * the predicate of index lookups.
+	 */
+	template<class K>
+	struct key_equal {
+		typedef K key_type;
+		typedef Equal equal_type;
+
+		const Equal &equal;
+		const K &key;
+
+		key_equal(const Equal &equal, const K &key) : equal(equal), key(key) {}
+
+		bool operator()(const Node *node) const {
+			return equal(node->data.first, key);
+		}
+	};
+
+	/**
+	 * the cached hashes reject most of the chain before Equal is called.
+	 */
+	template<class K>
+	Node* find_node(const K &key, size_t hash) const {
+		return index.find(hash, key_equal<K>(equal_func, key));
+	}
+
+	/**
+	 * copy the elements of other into this empty map, in order.
+	 * The keys of other are unique and their hashes are cached, so the
+	 *   buckets are sized once and every node is linked without a lookup.
+	 */
+	void clone_from(const linked_hashmap &other) {
+		index.policy(other.index.policy());
+		index.max_load_factor(other.index.max_load_factor());
+		if (index.bucket_count() != other.index.bucket_count()) {
+			index.rehash(other.index.bucket_count());
+		}
+		if (other.element_count == 0) return;
+		reserve_nodes(node_alloc, other.element_count);
+		for (const NodeBase *curr = other.head.next; curr != &other.tail; curr = curr->next) {
+			const Node *source = static_cast<const Node *>(curr);
+			link_node(create_node(source->hash, source->data));
+		}
+	}
+
+	static const size_t LOOKUP_BATCH = 32;
+
+	/**
+	 * look up keys[0, n) in batches: hash the batch and prefetch its buckets,
+	 *   then its first entries, then resolve, calling visit(i, node or nullptr).
+	 */
+	template<class Visit>
+	void lookup_batch(const Key *keys, size_t n, Visit visit) const {
+		size_t hashes[LOOKUP_BATCH];
+		for (size_t base = 0; base < n; base += LOOKUP_BATCH) {
+			size_t batch = n - base < LOOKUP_BATCH ? n - base : LOOKUP_BATCH;
+			for (size_t i = 0; i < batch; ++i) {
+				hashes[i] = hash_of(keys[base + i]);
+				index.prefetch_bucket(hashes[i]);
+			}
+			for (size_t i = 0; i < batch; ++i) {
+				index.prefetch_entry(hashes[i]);
+			}
+			for (size_t i = 0; i < batch; ++i) {
+				visit(base + i, find_node(keys[base + i], hashes[i]));
+			}
+		}
+	}
+
+	/**
+	 * take node out of the insertion order and its bucket, keeping it alive.
+	 */
+	Node* detach_node(Node *node) {
+		order.erase(node);
+		node->prev->next = node->next;
+		node->next->prev = node->prev;
+		index.erase(node);
+		--element_count;
+		return node;
+	}
+
+	/**
+	 * take node out of the insertion order and its bucket, and free it.
+	 */
+	void unlink_node(Node *node) {
+		destroy_node(detach_node(node));
+	}
+
+	/**
+	 * append node to the insertion order and hook it into its bucket.
+	 * over the capacity, the front is evicted; node itself is never the front then.
 	 */
-	typedef pair<const Key, T> value_type;
+	void link_node(Node *node) {
+		node->prev = tail.prev;
+		node->next = &tail;
+		tail.prev->next = node;
+		tail.prev = node;
+		order.insert_before(node, nullptr);
+		index.insert(node);
+		++element_count;
+		if (capacity_limit) evict_over_capacity();
+	}
 
-private:
-	struct Node {
-		value_type *data;
-		Node *prev;
-		Node *next;
-		Node *hash_next;
-		
-		Node() : data(nullptr), prev(nullptr), next(nullptr), hash_next(nullptr) {}
-		Node(const value_type &val) : data(new value_type(val)), prev(nullptr), next(nullptr), hash_next(nullptr) {}
-		~Node() { if (data) delete data; }
-	};
-	
-	Node *head;
-	Node *tail;
-	Node **buckets;
-	size_t bucket_count;
-	size_t element_count;
-	Hash hash_func;
-	Equal equal_func;
-	
-	static const size_t INITIAL_BUCKET_COUNT = 16;
-	static constexpr double MAX_LOAD_FACTOR = 0.75;
-	
-	void init_buckets(size_t count) {
-		bucket_count = count;
-		buckets = new Node*[bucket_count];
-		for (size_t i = 0; i < bucket_count; ++i) {
-			buckets[i] = nullptr;
+	void evict_over_capacity() {
+		while (element_count > capacity_limit) {
+			Node *victim = as_node(head.next);
+			if (on_evict) on_evict(victim->data);
+			unlink_node(victim);
 		}
 	}
-	
-	void rehash(size_t new_bucket_count) {
-		Node **old_buckets = buckets;
-		size_t old_bucket_count = bucket_count;
-		
-		init_buckets(new_bucket_count);
-		
-		Node *curr = head->next;
-		while (curr != tail) {
-			size_t idx = hash_func(curr->data->first) % bucket_count;
-			curr->hash_next = buckets[idx];
-			buckets[idx] = curr;
-			curr = curr->next;
-		}
-		
-		delete[] old_buckets;
+
+	/**
+	 * move node right before position, without touching its bucket.
+	 */
+	void relink_before(NodeBase *node, NodeBase *position) {
+		if (node == position || node->next == position) return;
+		order.erase(as_node(node));
+		node->prev->next = node->next;
+		node->next->prev = node->prev;
+		node->prev = position->prev;
+		node->next = position;
+		position->prev->next = node;
+		position->prev = node;
+		order.insert_before(as_node(node), order_position(position));
 	}
-	
-	void check_and_rehash() {
-		if (element_count > bucket_count * MAX_LOAD_FACTOR) {
-			rehash(bucket_count * 2);
-		}
+
+	Node* order_position(NodeBase *position) {
+		return position == &tail ? nullptr : as_node(position);
 	}
-	
-	Node* find_node(const Key &key) const {
-		size_t idx = hash_func(key) % bucket_count;
-		Node *curr = buckets[idx];
-		while (curr) {
-			if (equal_func(curr->data->first, key)) {
-				return curr;
-			}
-			curr = curr->hash_next;
-		}
-		return nullptr;
+
+	/**
+	 * head.prev and tail.next stay null, so the iterators see the ends
+	 *   without loading the map.
+	 */
+	static bool at_end(const NodeBase *node) {
+		return !node || !node->next;
+	}
+
+	static bool at_begin(const NodeBase *node) {
+		return !node || !node->prev || !node->prev->prev;
+	}
+
+	void check_element(const linked_hashmap *owner, const NodeBase *node) const {
+		SJTU_CHECK(owner == this && node != &tail && node != &head, invalid_iterator);
 	}
  
 public:
@@ -116,7 +2585,7 @@ public:
 		 * TODO add data members
 		 *   just add whatever you want.
 		 */
-		Node *node;
+		NodeBase *node;
 		const linked_hashmap *map;
 		
 		friend class linked_hashmap;
@@ -126,40 +2595,38 @@ public:
 		using value_type = typename linked_hashmap::value_type;
 		using pointer = value_type*;
 		using reference = value_type&;
-		using iterator_category = std::output_iterator_tag;
+		using iterator_category = std::bidirectional_iterator_tag;
 
 		iterator() : node(nullptr), map(nullptr) {}
-		iterator(Node *n, const linked_hashmap *m) : node(n), map(m) {}
+		iterator(NodeBase *n, const linked_hashmap *m) : node(n), map(m) {}
 		iterator(const iterator &other) : node(other.node), map(other.map) {}
 		
 		iterator operator++(int) {
-			if (!node || node == map->tail) throw invalid_iterator();
 			iterator temp = *this;
-			node = node->next;
+			++*this;
 			return temp;
 		}
 		
 		iterator & operator++() {
-			if (!node || node == map->tail) throw invalid_iterator();
+			if (checked_iterators) SJTU_CHECK(!at_end(node), invalid_iterator);
 			node = node->next;
 			return *this;
 		}
 		
 		iterator operator--(int) {
-			if (!node || node->prev == map->head) throw invalid_iterator();
 			iterator temp = *this;
-			node = node->prev;
+			--*this;
 			return temp;
 		}
 		
 		iterator & operator--() {
-			if (!node || node->prev == map->head) throw invalid_iterator();
+			if (checked_iterators) SJTU_CHECK(!at_begin(node), invalid_iterator);
 			node = node->prev;
 			return *this;
 		}
 		
 		value_type & operator*() const {
-			return *(node->data);
+			return as_node(node)->data;
 		}
 		
 		bool operator==(const iterator &rhs) const {
@@ -179,56 +2646,54 @@ public:
 		}
 
 		value_type* operator->() const noexcept {
-			return node->data;
+			return &as_node(node)->data;
 		}
 	};
  
 	class const_iterator {
 		private:
-			Node *node;
+			NodeBase *node;
 			const linked_hashmap *map;
 			
 			friend class linked_hashmap;
 		public:
 			using difference_type = std::ptrdiff_t;
 			using value_type = typename linked_hashmap::value_type;
-			using pointer = value_type*;
-			using reference = value_type&;
-			using iterator_category = std::output_iterator_tag;
+			using pointer = const value_type*;
+			using reference = const value_type&;
+			using iterator_category = std::bidirectional_iterator_tag;
 			
 			const_iterator() : node(nullptr), map(nullptr) {}
-			const_iterator(Node *n, const linked_hashmap *m) : node(n), map(m) {}
+			const_iterator(NodeBase *n, const linked_hashmap *m) : node(n), map(m) {}
 			const_iterator(const const_iterator &other) : node(other.node), map(other.map) {}
 			const_iterator(const iterator &other) : node(other.node), map(other.map) {}
 			
 			const_iterator operator++(int) {
-				if (!node || node == map->tail) throw invalid_iterator();
 				const_iterator temp = *this;
-				node = node->next;
+				++*this;
 				return temp;
 			}
 			
 			const_iterator & operator++() {
-				if (!node || node == map->tail) throw invalid_iterator();
+				if (checked_iterators) SJTU_CHECK(!at_end(node), invalid_iterator);
 				node = node->next;
 				return *this;
 			}
 			
 			const_iterator operator--(int) {
-				if (!node || node->prev == map->head) throw invalid_iterator();
 				const_iterator temp = *this;
-				node = node->prev;
+				--*this;
 				return temp;
 			}
 			
 			const_iterator & operator--() {
-				if (!node || node->prev == map->head) throw invalid_iterator();
+				if (checked_iterators) SJTU_CHECK(!at_begin(node), invalid_iterator);
 				node = node->prev;
 				return *this;
 			}
 			
 			const value_type & operator*() const {
-				return *(node->data);
+				return as_node(node)->data;
 			}
 			
 			bool operator==(const iterator &rhs) const {
@@ -248,152 +2713,562 @@ public:
 			}
 
 			const value_type* operator->() const noexcept {
-				return node->data;
+				return &as_node(node)->data;
 			}
 	};
+
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
  
+	/**
+	 * an element taken out of a map by extract(), owning its node, which can
+	 *   be inserted into another map of the same type without reallocation.
+	 * It keeps the allocator of the node, so it may outlive its map.
+	 */
+	class node_type {
+	private:
+		Node *node;
+		node_allocator alloc;
+
+		friend class linked_hashmap;
+
+		node_type(Node *node, const node_allocator &alloc) : node(node), alloc(alloc) {}
+
+		Node* release() {
+			Node *result = node;
+			node = nullptr;
+			return result;
+		}
+
+		void reset() {
+			if (!node) return;
+			node->~Node();
+			alloc.deallocate(node, 1);
+			node = nullptr;
+		}
+
+	public:
+		node_type() noexcept : node(nullptr) {}
+		node_type(const node_type &) = delete;
+		node_type(node_type &&other) noexcept : node(other.node), alloc(std::move(other.alloc)) {
+			other.node = nullptr;
+		}
+
+		node_type & operator=(node_type &&other) noexcept {
+			if (this == &other) return *this;
+			reset();
+			node = other.node;
+			alloc = std::move(other.alloc);
+			other.node = nullptr;
+			return *this;
+		}
+
+		~node_type() {
+			reset();
+		}
+
+		bool empty() const noexcept {
+			return node == nullptr;
+		}
+
+		explicit operator bool() const noexcept {
+			return node != nullptr;
+		}
+
+		/**
+		 * the handle must not be empty.
+		 */
+		const Key & key() const {
+			return node->data.first;
+		}
+
+		T & mapped() const {
+			return node->data.second;
+		}
+
+		value_type & value() const {
+			return node->data;
+		}
+	};
+
+	/**
+	 * what insert(node_type &&) did: position is the element inserted, or
+	 *   the one that prevented it, whose node is then handed back in node.
+	 */
+	struct insert_return_type {
+		iterator position;
+		bool inserted;
+		node_type node;
+	};
+
+private:
+	/**
+	 * the hashes cached by another map of this type can be reused when
+	 *   neither Hash nor BucketPolicy has any state (such as a seed).
+	 */
+	static const bool shared_hashes = std::is_empty<Hash>::value && std::is_empty<BucketPolicy>::value;
+
+	size_t hash_from(const Node *node) const {
+		return shared_hashes ? node->hash : hash_of(node->data.first);
+	}
+
+	/**
+	 * node, taken from a map whose nodes come from alloc, as a node of this
+	 *   map: itself if the allocators are equal, else a new node that the
+	 *   element is moved into (and the old one is freed).
+	 * If that allocation throws, node is left as it was.
+	 */
+	Node* adopt_node(Node *node, node_allocator &alloc, size_t hash) {
+		if (alloc == node_alloc) {
+			node->hash = hash;
+			return node;
+		}
+		Node *result = create_node(hash, std::move(node->data));
+		node->~Node();
+		alloc.deallocate(node, 1);
+		return result;
+	}
+
+	/**
+	 * move node of other before position; the insertion order of other
+	 *   still holds it until the new node exists.
+	 */
+	void steal_node(linked_hashmap &other, Node *node, size_t hash, NodeBase *position) {
+		check_and_rehash();
+		if (other.node_alloc == node_alloc) {
+			other.detach_node(node);
+			node->hash = hash;
+			link_node_before(node, position);
+			return;
+		}
+		Node *moved = create_node(hash, std::move(node->data));
+		other.unlink_node(node);
+		link_node_before(moved, position);
+	}
+
+	/**
+	 * link node (of this map) into the index and the order before position.
+	 * Unlike link_node it never evicts, so position stays valid.
+	 */
+	void link_node_before(Node *node, NodeBase *position) {
+		node->prev = position->prev;
+		node->next = position;
+		position->prev->next = node;
+		position->prev = node;
+		order.insert_before(node, order_position(position));
+		index.insert(node);
+		++element_count;
+	}
+
+	struct sibling_tag {};
+
+	linked_hashmap(const linked_hashmap &other, sibling_tag)
+		: element_count(0), hash_func(other.hash_func), equal_func(other.equal_func),
+		  node_alloc(other.node_alloc), index(other.get_allocator()), capacity_limit(0) {
+		init_sentinels();
+		index.policy(other.index.policy());
+		index.max_load_factor(other.index.max_load_factor());
+	}
+
+public:
 	/**
 	 * TODO two constructors
 	 */
-	linked_hashmap() : head(new Node()), tail(new Node()), element_count(0) {
-		head->next = tail;
-		tail->prev = head;
-		init_buckets(INITIAL_BUCKET_COUNT);
+	/**
+	 * an empty map allocates nothing until the first insert.
+	 */
+	linked_hashmap() : element_count(0), capacity_limit(0) {
+		init_sentinels();
+	}
+
+	explicit linked_hashmap(const Allocator &alloc)
+		: element_count(0), node_alloc(alloc), index(alloc), capacity_limit(0) {
+		init_sentinels();
 	}
 	
-	linked_hashmap(const linked_hashmap &other) : head(new Node()), tail(new Node()), element_count(0) {
-		head->next = tail;
-		tail->prev = head;
-		init_buckets(other.bucket_count);
-		
-		Node *curr = other.head->next;
-		while (curr != other.tail) {
-			insert(*(curr->data));
-			curr = curr->next;
+	linked_hashmap(const linked_hashmap &other)
+		: element_count(0), hash_func(other.hash_func), equal_func(other.equal_func),
+		  node_alloc(select_on_copy(other.node_alloc)), index(select_on_copy(other.get_allocator())),
+		  capacity_limit(other.capacity_limit), on_evict(other.on_evict) {
+		init_sentinels();
+		SJTU_TRY {
+			clone_from(other);
+		} SJTU_CATCH_ALL {
+			clear();
+			SJTU_RETHROW;
 		}
 	}
  
 	/**
 	 * TODO assignment operator
+	 * leaves *this with the bucket count and max_load_factor of other.
 	 */
 	linked_hashmap & operator=(const linked_hashmap &other) {
 		if (this == &other) return *this;
 		clear();
-		
-		Node *curr = other.head->next;
-		while (curr != other.tail) {
-			insert(*(curr->data));
-			curr = curr->next;
-		}
+		hash_func = other.hash_func;
+		equal_func = other.equal_func;
+		capacity_limit = other.capacity_limit;
+		on_evict = other.on_evict;
+		clone_from(other);
+		return *this;
+	}
+
+	/**
+	 * steals the nodes of other in O(1), leaving it empty.
+	 * iterators into other keep pointing at the elements,
+	 *   but must not be used with either map any more.
+	 */
+	linked_hashmap(linked_hashmap &&other) noexcept : element_count(0), capacity_limit(0) {
+		init_sentinels();
+		swap(other);
+	}
+
+	linked_hashmap & operator=(linked_hashmap &&other) noexcept {
+		if (this == &other) return *this;
+		clear();
+		swap(other);
 		return *this;
 	}
+
+	/**
+	 * exchanges the contents (and allocators) of two maps in O(1).
+	 * like a move, it invalidates the iterators of both maps.
+	 */
+	void swap(linked_hashmap &other) noexcept {
+		NodeBase *first = element_count ? head.next : nullptr, *last = tail.prev;
+		adopt_list(other.element_count ? other.head.next : nullptr, other.tail.prev);
+		other.adopt_list(first, last);
+		std::swap(element_count, other.element_count);
+		std::swap(hash_func, other.hash_func);
+		std::swap(equal_func, other.equal_func);
+		std::swap(node_alloc, other.node_alloc);
+		index.swap(other.index);
+		order.swap(other.order);
+		std::swap(capacity_limit, other.capacity_limit);
+		on_evict.swap(other.on_evict);
+	}
+
+	friend void swap(linked_hashmap &lhs, linked_hashmap &rhs) noexcept {
+		lhs.swap(rhs);
+	}
  
 	/**
 	 * TODO Destructors
 	 */
 	~linked_hashmap() {
 		clear();
-		delete head;
-		delete tail;
-		delete[] buckets;
+	}
+
+	allocator_type get_allocator() const {
+		return allocator_type(node_alloc);
+	}
+
+	Hash hash_function() const {
+		return hash_func;
+	}
+
+	Equal key_eq() const {
+		return equal_func;
+	}
+
+	/**
+	 * the hash this map caches for key: Hash, then the mixing of BucketPolicy.
+	 * Computing it touches nothing in the map, so it may be done ahead of
+	 *   time (and from other threads) and handed to insert_hashed.
+	 */
+	size_t hash_code(const Key &key) const {
+		return hash_of(key);
+	}
+ 
+	/**
+	 * TODO
+	 * access specified element with bounds checking
+	 * Returns a reference to the mapped value of the element with key equivalent to key.
+	 * If no such element exists, an exception of type `index_out_of_bound'
+	 */
+	T & at(const Key &key) {
+		Node *node = find_node(key);
+		SJTU_CHECK(node, index_out_of_bound);
+		return node->data.second;
+	}
+	
+	const T & at(const Key &key) const {
+		Node *node = find_node(key);
+		SJTU_CHECK(node, index_out_of_bound);
+		return node->data.second;
+	}
+
+	template<class K>
+	typename lookup_result<Hash, Equal, K, T &>::type at(const K &key) {
+		Node *node = find_node(key);
+		SJTU_CHECK(node, index_out_of_bound);
+		return node->data.second;
+	}
+
+	template<class K>
+	typename lookup_result<Hash, Equal, K, const T &>::type at(const K &key) const {
+		Node *node = find_node(key);
+		SJTU_CHECK(node, index_out_of_bound);
+		return node->data.second;
+	}
+
+	/**
+	 * at() that never throws nor asserts.
+	 * return a pointer to the mapped value, nullptr if key is not present.
+	 */
+	T * try_at(const Key &key) {
+		Node *node = find_node(key);
+		return node ? &node->data.second : nullptr;
+	}
+
+	const T * try_at(const Key &key) const {
+		Node *node = find_node(key);
+		return node ? &node->data.second : nullptr;
+	}
+
+	template<class K>
+	typename lookup_result<Hash, Equal, K, T *>::type try_at(const K &key) {
+		Node *node = find_node(key);
+		return node ? &node->data.second : nullptr;
+	}
+
+	template<class K>
+	typename lookup_result<Hash, Equal, K, const T *>::type try_at(const K &key) const {
+		Node *node = find_node(key);
+		return node ? &node->data.second : nullptr;
+	}
+ 
+	/**
+	 * TODO
+	 * access specified element 
+	 * Returns a reference to the value that is mapped to a key equivalent to key,
+	 *   performing an insertion if such key does not already exist.
+	 */
+	T & operator[](const Key &key) {
+		return try_emplace(key).first->second;
+	}
+
+	T & operator[](Key &&key) {
+		return try_emplace(std::move(key)).first->second;
+	}
+ 
+	/**
+	 * behave like at() throw index_out_of_bound if such key does not exist.
+	 */
+	const T & operator[](const Key &key) const {
+		return at(key);
+	}
+ 
+	/**
+	 * return a iterator to the beginning
+	 */
+	iterator begin() {
+		return iterator(head.next, this);
+	}
+	
+	const_iterator begin() const {
+		return cbegin();
+	}
+
+	const_iterator cbegin() const {
+		return const_iterator(head.next, this);
+	}
+ 
+	/**
+	 * return a iterator to the end
+	 * in fact, it returns past-the-end.
+	 */
+	iterator end() {
+		return iterator(&tail, this);
+	}
+	
+	const_iterator end() const {
+		return cend();
+	}
+
+	const_iterator cend() const {
+		return const_iterator(const_cast<NodeBase *>(&tail), this);
+	}
+
+	/**
+	 * the iteration order backwards, from the last element.
+	 */
+	reverse_iterator rbegin() {
+		return reverse_iterator(end());
+	}
+
+	const_reverse_iterator rbegin() const {
+		return crbegin();
+	}
+
+	const_reverse_iterator crbegin() const {
+		return const_reverse_iterator(cend());
+	}
+
+	reverse_iterator rend() {
+		return reverse_iterator(begin());
+	}
+
+	const_reverse_iterator rend() const {
+		return crend();
+	}
+
+	const_reverse_iterator crend() const {
+		return const_reverse_iterator(cbegin());
+	}
+ 
+	/**
+	 * checks whether the container is empty
+	 * return true if empty, otherwise false.
+	 */
+	bool empty() const {
+		return element_count == 0;
 	}
  
 	/**
-	 * TODO
-	 * access specified element with bounds checking
-	 * Returns a reference to the mapped value of the element with key equivalent to key.
-	 * If no such element exists, an exception of type `index_out_of_bound'
+	 * returns the number of elements.
+	 */
+	size_t size() const {
+		return element_count;
+	}
+
+	/**
+	 * returns the number of buckets (or slots) of the hash index.
+	 */
+	size_t bucket_count() const {
+		return index.bucket_count();
+	}
+
+	/**
+	 * the counters of an instrumented index, such as stats_index of
+	 *   linked_hashmap_stats.hpp; only declared when IndexPolicy keeps them.
+	 */
+	template<class Index = index_table>
+	auto stats() const -> decltype(std::declval<const Index &>().stats()) {
+		return index.stats();
+	}
+
+	/**
+	 * result[k] is the number of buckets holding k elements; see stats().
 	 */
-	T & at(const Key &key) {
-		Node *node = find_node(key);
-		if (!node) throw index_out_of_bound();
-		return node->data->second;
+	template<class Index = index_table>
+	auto bucket_histogram() const -> decltype(std::declval<const Index &>().bucket_histogram()) {
+		return index.bucket_histogram();
 	}
-	
-	const T & at(const Key &key) const {
-		Node *node = find_node(key);
-		if (!node) throw index_out_of_bound();
-		return node->data->second;
+
+	template<class Index = index_table>
+	auto reset_stats() -> decltype(std::declval<Index &>().reset_stats()) {
+		index.reset_stats();
 	}
- 
+
 	/**
-	 * TODO
-	 * access specified element 
-	 * Returns a reference to the value that is mapped to a key equivalent to key,
-	 *   performing an insertion if such key does not already exist.
+	 * call f(value_type &) on the elements in slice part of parts of the
+	 *   index, in no particular order; the parts slices together visit
+	 *   every element once, and none of them walks the order list.
+	 * Different slices touch different elements, so several threads may
+	 *   scan their own slices at once (see parallel_for_each).
 	 */
-	T & operator[](const Key &key) {
-		Node *node = find_node(key);
-		if (node) return node->data->second;
-		
-		value_type val(key, T());
-		auto result = insert(val);
-		return result.first->second;
+	template<class F>
+	void for_each_in_slice(size_t part, size_t parts, F f) {
+		index.for_each_in(part, parts, [&](Node *node) { f(node->data); });
 	}
- 
+
+	template<class F>
+	void for_each_in_slice(size_t part, size_t parts, F f) const {
+		index.for_each_in(part, parts, [&](const Node *node) { f(static_cast<const value_type &>(node->data)); });
+	}
+
 	/**
-	 * behave like at() throw index_out_of_bound if such key does not exist.
+	 * returns the average number of elements per bucket.
 	 */
-	const T & operator[](const Key &key) const {
-		return at(key);
+	float load_factor() const {
+		return bucket_count() ? static_cast<float>(element_count) / bucket_count() : 0.0f;
 	}
- 
+
 	/**
-	 * return a iterator to the beginning
+	 * the load factor beyond which the index grows.
 	 */
-	iterator begin() {
-		return iterator(head->next, this);
-	}
-	
-	const_iterator cbegin() const {
-		return const_iterator(head->next, this);
+	float max_load_factor() const {
+		return index.max_load_factor();
 	}
- 
+
 	/**
-	 * return a iterator to the end
-	 * in fact, it returns past-the-end.
+	 * sets the max load factor, rehashing at once if it is already exceeded.
+	 * open-addressing indexes may clamp it.
+	 * throw runtime_error, keeping the old one, unless ml is positive
+	 *   (zero, negative and NaN factors would make rehash divide by them).
 	 */
-	iterator end() {
-		return iterator(tail, this);
+	void max_load_factor(float ml) {
+		SJTU_CHECK(ml > 0, runtime_error);
+		index.max_load_factor(ml);
+		if (load_factor() > max_load_factor()) rehash(0);
 	}
-	
-	const_iterator cend() const {
-		return const_iterator(tail, this);
+
+	/**
+	 * rebuilds the index with at least count buckets,
+	 *   and at least enough for size() elements without exceeding max_load_factor().
+	 * may shrink the index. iterators stay valid.
+	 */
+	void rehash(size_t count) {
+		size_t needed = static_cast<size_t>(std::ceil(element_count / max_load_factor()));
+		index.rehash(count > needed ? count : needed);
 	}
- 
+
 	/**
-	 * checks whether the container is empty
-	 * return true if empty, otherwise false.
+	 * makes room for count elements, so inserting them never rehashes.
 	 */
-	bool empty() const {
-		return element_count == 0;
+	void reserve(size_t count) {
+		size_t needed = static_cast<size_t>(std::ceil(count / max_load_factor()));
+		if (needed > bucket_count()) rehash(needed);
 	}
- 
+
 	/**
-	 * returns the number of elements.
+	 * shrinks the index to the smallest that fits the current elements,
+	 *   e.g. after a mass erase.
 	 */
-	size_t size() const {
-		return element_count;
+	void shrink_to_fit() {
+		rehash(0);
 	}
  
 	/**
 	 * clears the contents
 	 */
 	void clear() {
-		Node *curr = head->next;
-		while (curr != tail) {
-			Node *next = curr->next;
-			delete curr;
+		NodeBase *curr = head.next;
+		while (curr != &tail) {
+			NodeBase *next = curr->next;
+			destroy_node(as_node(curr));
 			curr = next;
 		}
-		head->next = tail;
-		tail->prev = head;
+		head.next = &tail;
+		tail.prev = &head;
 		element_count = 0;
-		for (size_t i = 0; i < bucket_count; ++i) {
-			buckets[i] = nullptr;
-		}
+		index.clear();
+		order.clear();
+		release_unused(node_alloc);
 	}
  
+private:
+	/**
+	 * the shared body of insert/try_emplace: key hashes to hash, and the value
+	 *   is only built from args when key is missing.
+	 */
+	template<class... Args>
+	pair<iterator, bool> emplace_hashed(size_t hash, const Key &key, Args&&... args) {
+		Node *existing = find_node(key, hash);
+		if (existing) {
+			return pair<iterator, bool>(iterator(existing, this), false);
+		}
+
+		check_and_rehash();
+
+		Node *new_node = create_node(hash, std::forward<Args>(args)...);
+		link_node(new_node);
+		return pair<iterator, bool>(iterator(new_node, this), true);
+	}
+
+public:
 	/**
 	 * insert an element.
 	 * return a pair, the first of the pair is
@@ -401,26 +3276,104 @@ public:
 	 *   the second one is true if insert successfully, or false.
 	 */
 	pair<iterator, bool> insert(const value_type &value) {
-		Node *existing = find_node(value.first);
+		return emplace_hashed(hash_of(value.first), value.first, value);
+	}
+
+	/**
+	 * insert(value), given hash == hash_code(value.first).
+	 * A wrong hash leaves the element unreachable by lookups.
+	 */
+	pair<iterator, bool> insert_hashed(size_t hash, const value_type &value) {
+		return emplace_hashed(hash, value.first, value);
+	}
+
+	/**
+	 * insert values[0, n) in order, like insert() on each of them,
+	 *   but room for all of them is made once up front.
+	 * return the number of values actually inserted.
+	 */
+	size_t insert_batch(const value_type *values, size_t n) {
+		reserve(element_count + n);
+		reserve_nodes(node_alloc, n);
+		size_t inserted = 0;
+		for (size_t i = 0; i < n; ++i) {
+			if (emplace_hashed(hash_of(values[i].first), values[i].first, values[i]).second) ++inserted;
+		}
+		return inserted;
+	}
+
+	/**
+	 * like insert(const value_type &), but the mapped value is moved into the node.
+	 * (the key of a value_type is const, so it is still copied.)
+	 */
+	pair<iterator, bool> insert(value_type &&value) {
+		return emplace_hashed(hash_of(value.first), value.first, std::move(value));
+	}
+
+	/**
+	 * build a value_type from args and insert it.
+	 * The node is built first, since the key is only known afterwards;
+	 *   it is thrown away again if the key is already present.
+	 * return the same as insert().
+	 */
+	template<class... Args>
+	pair<iterator, bool> emplace(Args&&... args) {
+		Node *new_node = create_node(0, std::forward<Args>(args)...);
+		SJTU_TRY {
+			new_node->hash = hash_of(new_node->data.first);
+			Node *existing = find_node(new_node->data.first, new_node->hash);
+			if (existing) {
+				destroy_node(new_node);
+				return pair<iterator, bool>(iterator(existing, this), false);
+			}
+			check_and_rehash();
+		} SJTU_CATCH_ALL {
+			destroy_node(new_node);
+			SJTU_RETHROW;
+		}
+		link_node(new_node);
+		return pair<iterator, bool>(iterator(new_node, this), true);
+	}
+
+	/**
+	 * if key is missing, insert (key, T(args...)); otherwise do nothing,
+	 *   and args are left untouched.
+	 * return the same as insert().
+	 */
+	template<class... Args>
+	pair<iterator, bool> try_emplace(const Key &key, Args&&... args) {
+		return emplace_hashed(hash_of(key), key, mapped_args_tag(), key, std::forward<Args>(args)...);
+	}
+
+	template<class... Args>
+	pair<iterator, bool> try_emplace(Key &&key, Args&&... args) {
+		return emplace_hashed(hash_of(key), key, mapped_args_tag(), std::move(key), std::forward<Args>(args)...);
+	}
+
+	/**
+	 * insert (key, obj) if key is missing, otherwise assign obj to its mapped value.
+	 * return the same as insert(); the second is false when it assigned.
+	 */
+	template<class M>
+	pair<iterator, bool> insert_or_assign(const Key &key, M &&obj) {
+		size_t hash = hash_of(key);
+		Node *existing = find_node(key, hash);
 		if (existing) {
+			existing->data.second = std::forward<M>(obj);
 			return pair<iterator, bool>(iterator(existing, this), false);
 		}
-		
-		check_and_rehash();
-		
-		Node *new_node = new Node(value);
-		
-		new_node->prev = tail->prev;
-		new_node->next = tail;
-		tail->prev->next = new_node;
-		tail->prev = new_node;
-		
-		size_t idx = hash_func(value.first) % bucket_count;
-		new_node->hash_next = buckets[idx];
-		buckets[idx] = new_node;
-		
-		++element_count;
-		return pair<iterator, bool>(iterator(new_node, this), true);
+		return emplace_hashed(hash, key, key, std::forward<M>(obj));
+	}
+
+	template<class M>
+	pair<iterator, bool> insert_or_assign(Key &&key, M &&obj) {
+		size_t hash = hash_of(key);
+		Node *existing = find_node(key, hash);
+		if (existing) {
+			existing->data.second = std::forward<M>(obj);
+			return pair<iterator, bool>(iterator(existing, this), false);
+		}
+		return emplace_hashed(hash, key, std::move(key), std::forward<M>(obj));
 	}
  
 	/**
@@ -429,27 +3382,309 @@ public:
 	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
 	 */
 	void erase(iterator pos) {
-		if (pos.map != this || pos.node == tail || pos.node == head) {
-			throw invalid_iterator();
+		check_element(pos.map, pos.node);
+
+		unlink_node(as_node(pos.node));
+	}
+
+	/**
+	 * erase() that never throws nor asserts.
+	 * return false, erasing nothing, if pos is end(), default-constructed
+	 *   or points into another map.
+	 */
+	bool try_erase(const_iterator pos) {
+		if (pos.map != this || !pos.node || pos.node == &tail) return false;
+		unlink_node(as_node(pos.node));
+		return true;
+	}
+
+	/**
+	 * move the element at pos to the back of the iteration order (the most
+	 *   recently used end), in O(1) and without reallocating it.
+	 * pos and every other iterator stay valid.
+	 *
+	 * throw invalid_iterator if pos is end() or points into another map.
+	 */
+	void touch(iterator pos) {
+		check_element(pos.map, pos.node);
+		relink_before(pos.node, &tail);
+	}
+
+	void move_to_back(iterator pos) {
+		touch(pos);
+	}
+
+	/**
+	 * the opposite of move_to_back: pos becomes the first element.
+	 */
+	void move_to_front(iterator pos) {
+		check_element(pos.map, pos.node);
+		relink_before(pos.node, head.next);
+	}
+
+	/**
+	 * erase the first (least recently used) element.
+	 * throw container_is_empty if the map is empty.
+	 */
+	void pop_front() {
+		SJTU_CHECK(element_count != 0, container_is_empty);
+		unlink_node(as_node(head.next));
+	}
+
+	/**
+	 * erase the last (most recently inserted or touched) element.
+	 * throw container_is_empty if the map is empty.
+	 */
+	void pop_back() {
+		SJTU_CHECK(element_count != 0, container_is_empty);
+		unlink_node(as_node(tail.prev));
+	}
+
+	/**
+	 * pop_front() and pop_back() that never throw nor assert.
+	 * return false if the map was empty.
+	 */
+	bool try_pop_front() {
+		if (element_count == 0) return false;
+		unlink_node(as_node(head.next));
+		return true;
+	}
+
+	bool try_pop_back() {
+		if (element_count == 0) return false;
+		unlink_node(as_node(tail.prev));
+		return true;
+	}
+
+	/**
+	 * bound the map to capacity elements (0 means unbounded).
+	 * Whenever an insert takes the map over it, the front element is passed
+	 *   to on_evict (if given) and erased. A smaller capacity evicts at once.
+	 * Copies of the map keep the capacity and the callback.
+	 */
+	void set_capacity(size_t capacity, std::function<void(value_type &)> evict = nullptr) {
+		capacity_limit = capacity;
+		on_evict = evict;
+		if (capacity_limit) evict_over_capacity();
+	}
+
+	size_t capacity() const {
+		return capacity_limit;
+	}
+
+	/**
+	 * erase the element with key equivalent to key, if there is one.
+	 * return the number of elements erased (0 or 1).
+	 */
+	size_t erase(const Key &key) {
+		Node *node = find_node(key);
+		if (!node) return 0;
+		unlink_node(node);
+		return 1;
+	}
+
+	/**
+	 * the transparent version, see lookup_result. It never takes an
+	 *   iterator, which a transparent Hash and Equal might accept as a key.
+	 */
+	template<class K>
+	typename std::enable_if<!std::is_convertible<const K &, iterator>::value
+		&& !std::is_convertible<const K &, const_iterator>::value,
+		typename lookup_result<Hash, Equal, K, size_t>::type>::type erase(const K &key) {
+		Node *node = find_node(key);
+		if (!node) return 0;
+		unlink_node(node);
+		return 1;
+	}
+
+	/**
+	 * erase the elements of [first, last), in order.
+	 * return an iterator to last.
+	 *
+	 * throw invalid_iterator, erasing nothing, if first or last belongs to
+	 *   another map, or if last is not reachable from first. Unless last is
+	 *   end(), checking that walks the range once before erasing it.
+	 */
+	iterator erase(iterator first, iterator last) {
+		SJTU_CHECK(first.map == this && last.map == this && first.node && last.node, invalid_iterator);
+		if (last.node != &tail) {
+			for (NodeBase *curr = first.node; curr != last.node; curr = curr->next) {
+				SJTU_CHECK(curr != &tail, invalid_iterator);
+			}
 		}
-		
-		Node *node = pos.node;
-		
-		node->prev->next = node->next;
-		node->next->prev = node->prev;
-		
-		size_t idx = hash_func(node->data->first) % bucket_count;
-		Node **curr_ptr = &buckets[idx];
-		while (*curr_ptr) {
-			if (*curr_ptr == node) {
-				*curr_ptr = node->hash_next;
-				break;
+		NodeBase *curr = first.node;
+		while (curr != last.node) {
+			NodeBase *next = curr->next;
+			unlink_node(as_node(curr));
+			curr = next;
+		}
+		return last;
+	}
+
+	/**
+	 * an empty map with the Hash, Equal, bucket policy (and seed) and max
+	 *   load factor of this one, whose nodes come from the same pool, so that
+	 *   extract/insert, merge and splice between the two never reallocate.
+	 * Siblings share their allocator: use them from one thread at a time.
+	 */
+	linked_hashmap sibling() const {
+		return linked_hashmap(*this, sibling_tag());
+	}
+
+	/**
+	 * take the element at pos out of the map, without copying or freeing it.
+	 * throw invalid_iterator if pos is end() or points into another map.
+	 */
+	node_type extract(const_iterator pos) {
+		check_element(pos.map, pos.node);
+		return node_type(detach_node(as_node(pos.node)), node_alloc);
+	}
+
+	/**
+	 * return an empty handle if key is missing.
+	 */
+	node_type extract(const Key &key) {
+		Node *node = find_node(key);
+		if (!node) return node_type();
+		return node_type(detach_node(node), node_alloc);
+	}
+
+	/**
+	 * insert the element of handle at the back, unless its key is present.
+	 * The node itself is linked when handle came from a map with an equal
+	 *   allocator (a sibling, or any map with a stateless allocator), and
+	 *   its cached hash is kept when Hash and BucketPolicy are stateless.
+	 */
+	insert_return_type insert(node_type &&handle) {
+		if (handle.empty()) return insert_return_type{end(), false, node_type()};
+		size_t hash = hash_from(handle.node);
+		Node *existing = find_node(handle.key(), hash);
+		if (existing) return insert_return_type{iterator(existing, this), false, std::move(handle)};
+		check_and_rehash();
+		Node *node = adopt_node(handle.node, handle.alloc, hash);
+		handle.release();
+		link_node(node);
+		return insert_return_type{iterator(node, this), true, node_type()};
+	}
+
+	/**
+	 * move every element of other whose key is missing here to the back
+	 *   of this map, in the order of other; the others stay in other.
+	 * No element is copied; nodes are relinked when the allocators are equal.
+	 */
+	void merge(linked_hashmap &other) {
+		if (&other == this) return;
+		splice(cend(), other, other.cbegin(), other.cend());
+	}
+
+	void merge(linked_hashmap &&other) {
+		merge(other);
+	}
+
+	/**
+	 * move the elements of [first, last) of other before pos, in order, as
+	 *   merge does; elements whose key is present here stay in other.
+	 * With other == *this, [first, last) is moved before pos, which must
+	 *   not lie inside it.
+	 * A map with a capacity evicts from the front once all are moved.
+	 *
+	 * throw invalid_iterator if pos does not belong to this map, or first
+	 *   and last to other, or last does not follow first.
+	 */
+	void splice(const_iterator pos, linked_hashmap &other, const_iterator first, const_iterator last) {
+		SJTU_CHECK(pos.map == this && pos.node && first.map == &other && last.map == &other && first.node,
+			invalid_iterator);
+		for (NodeBase *curr = first.node; curr != last.node; curr = curr->next) {
+			SJTU_CHECK(curr != &other.tail && (&other != this || curr != pos.node), invalid_iterator);
+		}
+		NodeBase *curr = first.node;
+		while (curr != last.node) {
+			NodeBase *next = curr->next;
+			Node *node = as_node(curr);
+			if (&other == this) {
+				relink_before(node, pos.node);
+			} else {
+				size_t hash = hash_from(node);
+				if (!find_node(node->data.first, hash)) steal_node(other, node, hash, pos.node);
 			}
-			curr_ptr = &((*curr_ptr)->hash_next);
+			curr = next;
 		}
-		
-		delete node;
-		--element_count;
+		if (capacity_limit) evict_over_capacity();
+	}
+
+	void splice(const_iterator pos, linked_hashmap &other, const_iterator it) {
+		SJTU_CHECK(it.map == &other, invalid_iterator);
+		other.check_element(it.map, it.node);
+		const_iterator last = it;
+		splice(pos, other, it, ++last);
+	}
+
+	void splice(const_iterator pos, linked_hashmap &other) {
+		if (&other == this) return;
+		splice(pos, other, other.cbegin(), other.cend());
+	}
+
+	/**
+	 * the element at position k of the iteration order, in O(log n).
+	 * Only with OrderPolicy = ranked_order.
+	 *
+	 * throw index_out_of_bound if k >= size().
+	 */
+	iterator nth(size_t k) {
+		static_assert(OrderPolicy::ranked, "nth needs OrderPolicy = ranked_order");
+		SJTU_CHECK(k < element_count, index_out_of_bound);
+		return iterator(order.nth(k), this);
+	}
+
+	const_iterator nth(size_t k) const {
+		static_assert(OrderPolicy::ranked, "nth needs OrderPolicy = ranked_order");
+		SJTU_CHECK(k < element_count, index_out_of_bound);
+		return const_iterator(order.nth(k), this);
+	}
+
+	/**
+	 * the number of elements before pos in the iteration order, in
+	 *   O(log n); size() for end().
+	 * Only with OrderPolicy = ranked_order.
+	 *
+	 * throw invalid_iterator if pos does not belong to this map.
+	 */
+	size_t position_of(const_iterator pos) const {
+		static_assert(OrderPolicy::ranked, "position_of needs OrderPolicy = ranked_order");
+		SJTU_CHECK(pos.map == this && pos.node, invalid_iterator);
+		if (pos.node == &tail) return element_count;
+		return order.position_of(as_node(pos.node));
+	}
+
+private:
+	/**
+	 * the node n elements away from pos, for advance.
+	 */
+	NodeBase* advanced(const_iterator pos, std::ptrdiff_t n) const {
+		size_t from = position_of(pos);
+		SJTU_CHECK(n < 0 ? static_cast<size_t>(-(n + 1)) < from : static_cast<size_t>(n) <= element_count - from,
+			index_out_of_bound);
+		size_t to = from + static_cast<size_t>(n);
+		if (to == element_count) return const_cast<NodeBase *>(static_cast<const NodeBase *>(&tail));
+		return order.nth(to);
+	}
+
+public:
+	/**
+	 * pos moved by n elements (backwards for a negative n), in O(log n)
+	 *   whatever n is; moving to size() gives end().
+	 * Only with OrderPolicy = ranked_order.
+	 *
+	 * throw invalid_iterator if pos does not belong to this map, and
+	 *   index_out_of_bound if the result would lie before begin() or
+	 *   after end().
+	 */
+	iterator advance(iterator pos, std::ptrdiff_t n) {
+		return iterator(advanced(const_iterator(pos), n), this);
+	}
+
+	const_iterator advance(const_iterator pos, std::ptrdiff_t n) const {
+		return const_iterator(advanced(pos, n), this);
 	}
  
 	/**
@@ -461,6 +3696,11 @@ public:
 	size_t count(const Key &key) const {
 		return find_node(key) ? 1 : 0;
 	}
+
+	template<class K>
+	typename lookup_result<Hash, Equal, K, size_t>::type count(const K &key) const {
+		return find_node(key) ? 1 : 0;
+	}
  
 	/**
 	 * Finds an element with key equivalent to key.
@@ -477,6 +3717,51 @@ public:
 		Node *node = find_node(key);
 		return node ? const_iterator(node, this) : cend();
 	}
+
+	/**
+	 * find every key of keys[0, n): out[i] = find(keys[i]).
+	 * the lookups are interleaved so that their cache misses overlap.
+	 */
+	void find_batch(const Key *keys, size_t n, iterator *out) {
+		lookup_batch(keys, n, [&](size_t i, Node *node) {
+			out[i] = node ? iterator(node, this) : end();
+		});
+	}
+
+	void find_batch(const Key *keys, size_t n, const_iterator *out) const {
+		lookup_batch(keys, n, [&](size_t i, Node *node) {
+			out[i] = node ? const_iterator(node, this) : cend();
+		});
+	}
+
+	/**
+	 * like find_batch, but only out[i] = count(keys[i]) (out may be nullptr).
+	 * return how many of the keys are present.
+	 */
+	size_t count_batch(const Key *keys, size_t n, size_t *out = nullptr) const {
+		size_t found = 0;
+		lookup_batch(keys, n, [&](size_t i, Node *node) {
+			if (out) out[i] = node ? 1 : 0;
+			if (node) ++found;
+		});
+		return found;
+	}
+
+	/**
+	 * the transparent versions of find, see lookup_result.
+	 * key is hashed and compared as it is, no Key is built from it.
+	 */
+	template<class K>
+	typename lookup_result<Hash, Equal, K, iterator>::type find(const K &key) {
+		Node *node = find_node(key);
+		return node ? iterator(node, this) : end();
+	}
+
+	template<class K>
+	typename lookup_result<Hash, Equal, K, const_iterator>::type find(const K &key) const {
+		Node *node = find_node(key);
+		return node ? const_iterator(node, this) : cend();
+	}
 };
 
 }
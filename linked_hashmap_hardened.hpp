@@ -0,0 +1,478 @@
+/**
+ * hash-flooding protection for linked_hashmap: a seeded bucket policy and
+ * an index engine whose long chains turn into sorted runs
+ */
+#ifndef SJTU_LINKEDHASHMAP_HARDENED_HPP
+#define SJTU_LINKEDHASHMAP_HARDENED_HPP
+
+#include "linked_hashmap.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <type_traits>
+
+namespace sjtu {
+    /**
+     * pow2_mix_bucket with a random seed per map: the hash is xored with
+     * the seed before the murmur3 finalizer, so which keys share a bucket
+     * differs from map to map and cannot be worked out from Hash alone.
+     * The seeds derive from one random_device draw per process and a
+     * counter, so building a map costs no system call.
+     * Copies of a map keep its seed (they reuse its cached hashes).
+     *
+     * A Hash that already collides (a constant, x % 8) still collides:
+     * pair the policy with treeified_index for that.
+     */
+class seeded_mix_bucket {
+private:
+	size_t seed;
+
+	static unsigned long long process_seed() {
+		static const unsigned long long value = [] {
+			unsigned long long result = 0;
+			SJTU_TRY {
+				std::random_device device;
+				result = (static_cast<unsigned long long>(device()) << 32) ^ device();
+			} SJTU_CATCH_ALL {}
+			return result ^ static_cast<unsigned long long>(
+				std::chrono::steady_clock::now().time_since_epoch().count());
+		}();
+		return value;
+	}
+
+	static size_t next_seed() {
+		static std::atomic<unsigned long long> counter(0);
+		unsigned long long n = counter.fetch_add(1, std::memory_order_relaxed);
+		return pow2_mix_bucket::mix(static_cast<size_t>(process_seed() + n * 0x9e3779b97f4a7c15ULL));
+	}
+
+public:
+	static const bool power_of_two = true;
+
+	seeded_mix_bucket() noexcept : seed(next_seed()) {}
+	explicit seeded_mix_bucket(size_t seed) noexcept : seed(seed) {}
+
+	size_t seed_value() const {
+		return seed;
+	}
+
+	size_t mix(size_t hash) const {
+		return pow2_mix_bucket::mix(hash ^ seed);
+	}
+
+	static size_t index(size_t hash, size_t bucket_count) {
+		return hash & (bucket_count - 1);
+	}
+
+	static size_t bucket_count_for(size_t count) {
+		return pow2_mix_bucket::bucket_count_for(count);
+	}
+};
+
+namespace hardened_detail {
+	template<class K, class = void>
+	struct is_ordered : std::false_type {};
+
+	template<class K>
+	struct is_ordered<K, typename void_type<decltype(std::declval<const K &>() < std::declval<const K &>())>::type>
+		: std::true_type {};
+}
+
+    /**
+     * whether Equal holds exactly for the keys neither of which is
+     *   operator< than the other, so that treeified_index may sort by key.
+     * true for std::equal_to; specialize it for an Equal of your own that
+     *   agrees with operator< (not for one, like a case-insensitive
+     *   compare of strings, that does not).
+     */
+template<class Key, class Equal>
+struct key_order_agrees : std::integral_constant<bool,
+	std::is_same<Equal, std::equal_to<Key> >::value || std::is_same<Equal, std::equal_to<> >::value> {};
+
+    /**
+     * separate chaining like chained_index, but a bucket whose chain grows
+     * beyond TREEIFY_THRESHOLD entries becomes a sorted run: an array of
+     * its nodes ordered by cached hash, then by key when Key has operator<
+     * and key_order_agrees with Equal (as Java 8 HashMap treeifies by hash,
+     * then by Comparable).
+     * Lookups binary-search the run, so a flooded bucket costs O(log n)
+     * instead of O(n); inserting into it moves O(n) pointers, with memmove.
+     * A run shrinking below UNTREEIFY_THRESHOLD becomes a chain again.
+     *
+     * Otherwise, entries of one full hash stay in insertion order
+     * and are searched linearly: only the ordering by key helps against a
+     * Hash that collides on every key.
+     * Transparent lookups with another key type do the same.
+     *
+     * A bucket holds a Node * (a chain) or, with the low bit set, a run *.
+     */
+struct treeified_index {
+	template<class Node>
+	struct hook {
+		Node *hash_next;
+
+		hook() : hash_next(nullptr) {}
+	};
+
+	template<class Node, class BucketPolicy, class Allocator>
+	class table {
+	private:
+		typedef typename std::remove_const<typename std::remove_reference<
+			decltype(std::declval<const Node &>().data.first)>::type>::type key_type;
+
+		static const bool ordered = hardened_detail::is_ordered<key_type>::value &&
+			key_order_agrees<key_type, typename Node::equal_type>::value;
+
+		struct run {
+			size_t size;
+			size_t capacity;
+			Node **items;
+		};
+
+		typedef std::uintptr_t bucket;
+		typedef typename rebind_alloc<Allocator, bucket>::type bucket_allocator;
+		typedef typename rebind_alloc<Allocator, run>::type run_allocator;
+		typedef typename rebind_alloc<Allocator, Node *>::type item_allocator;
+
+		bucket *buckets;
+		size_t count;
+		bucket single_bucket;
+		float max_load;
+		BucketPolicy bucket_policy;
+		bucket_allocator alloc;
+		run_allocator runs;
+		item_allocator items;
+
+	public:
+		static const size_t TREEIFY_THRESHOLD = 8;
+		static const size_t UNTREEIFY_THRESHOLD = 6;
+
+	private:
+		static const size_t MIN_BUCKET_COUNT = 16;
+
+		static bool is_run(bucket b) {
+			return b & 1;
+		}
+
+		static run * as_run(bucket b) {
+			return reinterpret_cast<run *>(b & ~static_cast<bucket>(1));
+		}
+
+		static bucket of_run(run *r) {
+			return reinterpret_cast<bucket>(r) | 1;
+		}
+
+		static Node * as_chain(bucket b) {
+			return reinterpret_cast<Node *>(b);
+		}
+
+		static bucket of_chain(Node *node) {
+			return reinterpret_cast<bucket>(node);
+		}
+
+		bucket * allocate_buckets(size_t n) {
+			if (n == 1) {
+				single_bucket = 0;
+				return &single_bucket;
+			}
+			return allocate_zeroed(alloc, n);
+		}
+
+		/**
+		 * whether node goes before (hash, key) in a run.
+		 */
+		template<class K>
+		static bool before(const Node *node, size_t hash, const K &key, std::true_type) {
+			return node->hash < hash || (node->hash == hash && node->data.first < key);
+		}
+
+		template<class K>
+		static bool before(const Node *node, size_t hash, const K &, std::false_type) {
+			return node->hash < hash;
+		}
+
+		/**
+		 * the first position of r not before (hash, key).
+		 */
+		template<class K, class Order>
+		static size_t lower_bound(const run *r, size_t hash, const K &key, Order order) {
+			size_t first = 0, length = r->size;
+			while (length) {
+				size_t half = length / 2;
+				if (before(r->items[first + half], hash, key, order)) {
+					first += half + 1;
+					length -= half + 1;
+				} else {
+					length = half;
+				}
+			}
+			return first;
+		}
+
+		template<class Pred, class Order>
+		static Node * find_in_run(const run *r, size_t hash, const Pred &pred, Order order) {
+			for (size_t i = lower_bound(r, hash, pred.key, order); i < r->size && r->items[i]->hash == hash; ++i) {
+				if (pred(r->items[i])) return r->items[i];
+				if (Order::value) return nullptr;
+			}
+			return nullptr;
+		}
+
+		/**
+		 * ordered by key only when the probe has the type of the keys.
+		 */
+		template<class Pred>
+		static Node * find_in_run(const run *r, size_t hash, const Pred &pred) {
+			typedef std::integral_constant<bool, ordered &&
+				std::is_same<typename Pred::key_type, key_type>::value> order;
+			return find_in_run(r, hash, pred, order());
+		}
+
+		void release(run *r) {
+			items.deallocate(r->items, r->capacity);
+			runs.deallocate(r, 1);
+		}
+
+		void grow(run *r) {
+			size_t capacity = r->capacity * 2;
+			Node **larger = items.allocate(capacity);
+			memcpy(larger, r->items, r->size * sizeof(Node *));
+			items.deallocate(r->items, r->capacity);
+			r->items = larger;
+			r->capacity = capacity;
+		}
+
+		/**
+		 * after the entries equal to node, so an unordered run keeps
+		 *   insertion order within a hash. r must have room.
+		 */
+		void run_insert(run *r, Node *node) {
+			size_t pos = lower_bound(r, node->hash, node->data.first, std::integral_constant<bool, ordered>());
+			while (pos < r->size && r->items[pos]->hash == node->hash && !ordered) ++pos;
+			memmove(r->items + pos + 1, r->items + pos, (r->size - pos) * sizeof(Node *));
+			r->items[pos] = node;
+			++r->size;
+		}
+
+		void treeify(bucket &b, Node *chain, size_t length) {
+			run *r = runs.allocate(1);
+			r->size = 0;
+			r->capacity = length * 2;
+			SJTU_TRY {
+				r->items = items.allocate(r->capacity);
+			} SJTU_CATCH_ALL {
+				runs.deallocate(r, 1);
+				SJTU_RETHROW;
+			}
+			for (Node *curr = chain; curr; curr = curr->hash_next) run_insert(r, curr);
+			b = of_run(r);
+		}
+
+		void untreeify(bucket &b, run *r) {
+			Node *chain = nullptr;
+			for (size_t i = r->size; i > 0; --i) {
+				r->items[i - 1]->hash_next = chain;
+				chain = r->items[i - 1];
+			}
+			release(r);
+			b = of_chain(chain);
+		}
+
+		/**
+		 * never throws: a chain that cannot become a run for lack of memory
+		 *   stays a chain, and a run that cannot grow becomes one again.
+		 */
+		void push(Node *node) {
+			bucket &b = buckets[bucket_policy.index(node->hash, count)];
+			if (is_run(b)) {
+				run *r = as_run(b);
+				SJTU_TRY {
+					if (r->size == r->capacity) grow(r);
+					run_insert(r, node);
+					return;
+				} SJTU_CATCH_ALL {
+					untreeify(b, r);
+				}
+			}
+			node->hash_next = as_chain(b);
+			b = of_chain(node);
+			size_t length = 0;
+			for (Node *curr = node; curr && length <= TREEIFY_THRESHOLD; curr = curr->hash_next) ++length;
+			if (length > TREEIFY_THRESHOLD) {
+				SJTU_TRY {
+					treeify(b, node, length);
+				} SJTU_CATCH_ALL {}
+			}
+		}
+
+		template<class Visit>
+		static void visit_nodes(bucket b, Visit visit) {
+			if (is_run(b)) {
+				run *r = as_run(b);
+				for (size_t i = 0; i < r->size; ++i) visit(r->items[i]);
+			} else {
+				for (Node *curr = as_chain(b); curr; ) {
+					Node *next = curr->hash_next;
+					visit(curr);
+					curr = next;
+				}
+			}
+		}
+
+		void release_runs() {
+			for (size_t i = 0; i < count; ++i) {
+				if (is_run(buckets[i])) release(as_run(buckets[i]));
+			}
+		}
+
+	public:
+		explicit table(const Allocator &a = Allocator()) noexcept
+			: buckets(&single_bucket), count(1), single_bucket(0), max_load(0.75f), alloc(a), runs(a), items(a) {}
+		table(const table &) = delete;
+		table & operator=(const table &) = delete;
+
+		~table() {
+			release_runs();
+			if (buckets != &single_bucket) alloc.deallocate(buckets, count);
+		}
+
+		const BucketPolicy & policy() const {
+			return bucket_policy;
+		}
+
+		void policy(const BucketPolicy &p) {
+			bucket_policy = p;
+		}
+
+		void swap(table &other) noexcept {
+			bool single = buckets == &single_bucket;
+			bool other_single = other.buckets == &other.single_bucket;
+			std::swap(buckets, other.buckets);
+			std::swap(count, other.count);
+			std::swap(single_bucket, other.single_bucket);
+			std::swap(max_load, other.max_load);
+			std::swap(bucket_policy, other.bucket_policy);
+			std::swap(alloc, other.alloc);
+			std::swap(runs, other.runs);
+			std::swap(items, other.items);
+			if (other_single) buckets = &single_bucket;
+			if (single) other.buckets = &other.single_bucket;
+		}
+
+		size_t bucket_count() const {
+			return count;
+		}
+
+		float max_load_factor() const {
+			return max_load;
+		}
+
+		void max_load_factor(float ml) {
+			max_load = ml;
+		}
+
+		template<class Pred>
+		Node* find(size_t hash, Pred pred) const {
+			bucket b = buckets[bucket_policy.index(hash, count)];
+			if (is_run(b)) return find_in_run(as_run(b), hash, pred);
+			for (Node *curr = as_chain(b); curr; curr = curr->hash_next) {
+				if (curr->hash == hash && pred(curr)) {
+					return curr;
+				}
+			}
+			return nullptr;
+		}
+
+		void prefetch_bucket(size_t hash) const {
+			prefetch_address(buckets + bucket_policy.index(hash, count));
+		}
+
+		void prefetch_entry(size_t hash) const {
+			bucket b = buckets[bucket_policy.index(hash, count)];
+			if (b) prefetch_address(is_run(b) ? static_cast<const void *>(as_run(b)) : as_chain(b));
+		}
+
+		void insert(Node *node) {
+			push(node);
+		}
+
+		void erase(Node *node) {
+			bucket &b = buckets[bucket_policy.index(node->hash, count)];
+			if (is_run(b)) {
+				run *r = as_run(b);
+				size_t pos = lower_bound(r, node->hash, node->data.first, std::integral_constant<bool, ordered>());
+				while (pos < r->size && r->items[pos] != node) ++pos;
+				if (pos == r->size) return;
+				memmove(r->items + pos, r->items + pos + 1, (r->size - pos - 1) * sizeof(Node *));
+				--r->size;
+				if (r->size < UNTREEIFY_THRESHOLD) untreeify(b, r);
+				return;
+			}
+			Node *prev = nullptr;
+			for (Node *curr = as_chain(b); curr; prev = curr, curr = curr->hash_next) {
+				if (curr != node) continue;
+				if (prev) {
+					prev->hash_next = node->hash_next;
+				} else {
+					b = of_chain(node->hash_next);
+				}
+				return;
+			}
+		}
+
+		void clear() {
+			release_runs();
+			for (size_t i = 0; i < count; ++i) {
+				buckets[i] = 0;
+			}
+		}
+
+		template<class Visit>
+		void for_each_bucket(Visit visit) const {
+			for (size_t i = 0; i < count; ++i) {
+				size_t length = 0;
+				visit_nodes(buckets[i], [&](Node *) { ++length; });
+				visit(length);
+			}
+		}
+
+		template<class Visit>
+		void for_each_in(size_t part, size_t parts, Visit visit) const {
+			for (size_t i = slice_begin(count, part, parts); i < slice_begin(count, part + 1, parts); ++i) {
+				visit_nodes(buckets[i], visit);
+			}
+		}
+
+		void rehash(size_t n) {
+			bucket *old_buckets = buckets;
+			size_t old_count = count;
+			bucket old_single = single_bucket;
+			if (old_buckets == &single_bucket) old_buckets = &old_single;
+
+			size_t new_count = bucket_policy.bucket_count_for(n);
+			bucket *new_buckets = allocate_buckets(new_count);
+			buckets = new_buckets;
+			count = new_count;
+
+			for (size_t i = 0; i < old_count; ++i) {
+				visit_nodes(old_buckets[i], [&](Node *node) { push(node); });
+				if (is_run(old_buckets[i])) release(as_run(old_buckets[i]));
+			}
+
+			if (old_buckets != &old_single) alloc.deallocate(old_buckets, old_count);
+		}
+
+		void prepare_insert(size_t size) {
+			if (size > count * max_load) {
+				size_t target = count * 2 > MIN_BUCKET_COUNT ? count * 2 : MIN_BUCKET_COUNT;
+				size_t needed = static_cast<size_t>(size / max_load) + 1;
+				rehash(target > needed ? target : needed);
+			}
+		}
+	};
+};
+
+}
+
+#endif
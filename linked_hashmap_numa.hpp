@@ -0,0 +1,325 @@
+/**
+ * huge-page and NUMA placement for very large linked_hashmaps, and
+ * per-thread read replicas
+ */
+#ifndef SJTU_LINKEDHASHMAP_NUMA_HPP
+#define SJTU_LINKEDHASHMAP_NUMA_HPP
+
+#include "linked_hashmap.hpp"
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace sjtu {
+    /**
+     * Page kinds of mapped_source.
+     * bytes is the page size. Requests of at least min_request bytes are
+     *   mapped and rounded up to whole pages; smaller ones (the first slabs
+     *   and bucket arrays of every map) stay on the heap, so a small map
+     *   does not pin a huge page.
+     * huge_2mb and huge_1gb ask for hugetlbfs pages first. Without reserved
+     *   ones (vm.nr_hugepages is 0 by default) they fall back to ordinary
+     *   pages aligned to 2MB and marked MADV_HUGEPAGE, which transparent
+     *   huge pages back whenever the system allows it.
+     * small_pages maps ordinary pages, only so that Numa can place them.
+     */
+struct huge_2mb {
+	static const size_t bytes = size_t(1) << 21;
+	static const size_t min_request = size_t(1) << 18;
+	static const bool huge = true;
+	static const int log2 = 21;
+};
+
+struct huge_1gb {
+	static const size_t bytes = size_t(1) << 30;
+	static const size_t min_request = size_t(1) << 27;
+	static const bool huge = true;
+	static const int log2 = 30;
+};
+
+struct small_pages {
+	static const size_t bytes = size_t(1) << 12;
+	static const size_t min_request = size_t(1) << 16;
+	static const bool huge = false;
+	static const int log2 = 12;
+};
+
+    /**
+     * NUMA placements of mapped_source: place(ptr, bytes) runs on every
+     *   fresh mapping before it is touched.
+     * numa_first_touch leaves the kernel default: a page lands on the node
+     *   of the thread that touches it first.
+     * numa_interleave spreads the pages round-robin over the nodes in the
+     *   Nodes bit mask (all of them by default), so that threads on every
+     *   node share the bandwidth of a table none of them owns.
+     * numa_bind<Node> keeps the pages on one node.
+     * Placement is a hint: it goes straight to the mbind system call,
+     *   without libnuma, and a kernel or machine that refuses it (no NUMA,
+     *   a node that does not exist) leaves the default placement.
+     */
+namespace numa_detail {
+	static const int MPOL_BIND_MODE = 2;
+	static const int MPOL_INTERLEAVE_MODE = 3;
+
+	inline void mbind(void *ptr, size_t bytes, int mode, unsigned long nodes) {
+#if defined(SYS_mbind)
+		// maxnode counts one bit more than the kernel reads.
+		::syscall(SYS_mbind, ptr, bytes, mode, &nodes, sizeof(nodes) * 8 + 1, 0);
+#else
+		(void)ptr;
+		(void)bytes;
+		(void)mode;
+		(void)nodes;
+#endif
+	}
+}
+
+struct numa_first_touch {
+	static void place(void *, size_t) {}
+};
+
+template<unsigned long Nodes = ~0UL>
+struct numa_interleave {
+	static void place(void *ptr, size_t bytes) {
+		numa_detail::mbind(ptr, bytes, numa_detail::MPOL_INTERLEAVE_MODE, Nodes);
+	}
+};
+
+template<unsigned Node>
+struct numa_bind {
+	static_assert(Node < sizeof(unsigned long) * 8, "numa_bind takes a node below the mask width");
+
+	static void place(void *ptr, size_t bytes) {
+		numa_detail::mbind(ptr, bytes, numa_detail::MPOL_BIND_MODE, 1UL << Node);
+	}
+};
+
+    /**
+     * A pool_allocator source (see heap_source) that maps large requests
+     * straight from the kernel with mmap, in Page pages placed by Numa.
+     * The slabs of a pool fill the whole rounded mapping, so a map of
+     * millions of nodes keeps them, and its bucket table, on a few huge
+     * pages with one TLB entry each.
+     * Mappings come zeroed, so allocate_zeroed costs nothing more.
+     */
+template<class Page = huge_2mb, class Numa = numa_first_touch>
+struct mapped_source {
+	static void * allocate(size_t bytes) {
+		if (bytes < Page::min_request) return heap_source::allocate(bytes);
+		return map(usable_size(bytes));
+	}
+
+	static void * allocate_zeroed(size_t bytes) {
+		if (bytes < Page::min_request) return heap_source::allocate_zeroed(bytes);
+		return map(usable_size(bytes));
+	}
+
+	static void deallocate(void *ptr, size_t bytes) {
+		if (bytes < Page::min_request) {
+			heap_source::deallocate(ptr, bytes);
+			return;
+		}
+		::munmap(ptr, usable_size(bytes));
+	}
+
+	static size_t usable_size(size_t bytes) {
+		if (bytes < Page::min_request) return bytes;
+		return (bytes + Page::bytes - 1) / Page::bytes * Page::bytes;
+	}
+
+private:
+	static const size_t THP_BYTES = size_t(1) << 21;
+
+	static void * map(size_t bytes) {
+		void *raw = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+		if (Page::huge) {
+			raw = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (Page::log2 << 26), -1, 0);
+		}
+#endif
+		if (raw == MAP_FAILED && Page::huge) raw = map_aligned(bytes);
+		if (raw == MAP_FAILED && !Page::huge) {
+			raw = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		}
+		if (raw == MAP_FAILED) SJTU_THROW_BAD_ALLOC;
+		Numa::place(raw, bytes);
+		return raw;
+	}
+
+	/**
+	 * ordinary pages on a 2MB boundary, where a transparent huge page fits:
+	 *   map THP_BYTES more and cut off both ends.
+	 */
+	static void * map_aligned(size_t bytes) {
+		char *raw = static_cast<char *>(::mmap(nullptr, bytes + THP_BYTES, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+		if (raw == MAP_FAILED) return MAP_FAILED;
+		size_t head = (THP_BYTES - reinterpret_cast<size_t>(raw) % THP_BYTES) % THP_BYTES;
+		if (head) ::munmap(raw, head);
+		::munmap(raw + head + bytes, THP_BYTES - head);
+#if defined(MADV_HUGEPAGE)
+		::madvise(raw + head, bytes, MADV_HUGEPAGE);
+#endif
+		return raw + head;
+	}
+};
+
+    /**
+     * the allocator of a linked_hashmap whose large slabs and tables live
+     * on Page pages placed by Numa, e.g.
+     *   linked_hashmap<Key, T, Hash, Equal,
+     *     hugepage_allocator<pair<const Key, T>, huge_2mb, numa_interleave<> > >
+     */
+template<class T, class Page = huge_2mb, class Numa = numa_first_touch>
+using hugepage_allocator = pool_allocator<T, mapped_source<Page, Numa> >;
+
+    /**
+     * A linked_hashmap written under a lock and read through replicas.
+     *
+     * Every reader thread keeps a replica of its own (in a thread_local,
+     * or for the life of the thread function). A replica is a full copy of
+     * the map, made by the reader thread itself, so its nodes are first
+     * touched on the node that reads them; lookups then run on a private
+     * map, with no lock, no shared cache line and no remote memory.
+     *
+     * Writers bump a version under the lock. get() compares it with the
+     * version of the replica (one acquire load) and copies the map again
+     * when it moved on, reusing the nodes of the old copy. So reads see
+     * the map as of their last get(), and every write costs each reader one
+     * copy: this is for maps that are read far more often than written.
+     * Use the map of the replica on its own thread only.
+     */
+template<
+	class Key,
+	class T,
+	class Hash = std::hash<Key>,
+	class Equal = std::equal_to<Key>,
+	class Allocator = pool_allocator<pair<const Key, T> >
+> class replicated_linked_hashmap {
+public:
+	typedef linked_hashmap<Key, T, Hash, Equal, Allocator> map_type;
+	typedef pair<const Key, T> value_type;
+
+private:
+	mutable std::shared_mutex lock;
+	map_type master;
+	std::atomic<unsigned long long> current_version;
+
+	void publish() {
+		current_version.store(current_version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+public:
+	class replica {
+		friend class replicated_linked_hashmap;
+
+		const replicated_linked_hashmap *owner;
+		map_type local;
+		unsigned long long seen;
+
+	public:
+		/**
+		 * an empty replica of no map; get() must not be called on it.
+		 */
+		replica() : owner(nullptr), seen(0) {}
+
+		explicit replica(const replicated_linked_hashmap &owner) : owner(&owner), seen(0) {
+			refresh();
+		}
+
+		/**
+		 * the map as of now, copied again first if a writer changed it.
+		 */
+		const map_type & get() {
+			if (owner->current_version.load(std::memory_order_acquire) != seen) refresh();
+			return local;
+		}
+
+		/**
+		 * the map as of the last get(), without looking for changes.
+		 */
+		const map_type & cached() const {
+			return local;
+		}
+
+		unsigned long long version() const {
+			return seen;
+		}
+
+		void refresh() {
+			std::shared_lock<std::shared_mutex> guard(owner->lock);
+			local = owner->master;
+			seen = owner->current_version.load(std::memory_order_relaxed);
+		}
+	};
+
+	replicated_linked_hashmap() : current_version(1) {}
+
+	replicated_linked_hashmap(const replicated_linked_hashmap &) = delete;
+	replicated_linked_hashmap & operator=(const replicated_linked_hashmap &) = delete;
+
+	/**
+	 * a replica for the calling thread, copied on it.
+	 */
+	replica make_replica() const {
+		return replica(*this);
+	}
+
+	/**
+	 * call f(map_type &) under the write lock, and publish the result.
+	 */
+	template<class F>
+	void update(F f) {
+		std::unique_lock<std::shared_mutex> guard(lock);
+		f(master);
+		publish();
+	}
+
+	/**
+	 * insert (key, value), or assign value if key is present (in place, keeping its order).
+	 * return true if it was inserted.
+	 */
+	template<class M>
+	bool insert_or_assign(const Key &key, M &&value) {
+		std::unique_lock<std::shared_mutex> guard(lock);
+		bool inserted = master.insert_or_assign(key, std::forward<M>(value)).second;
+		publish();
+		return inserted;
+	}
+
+	/**
+	 * return the number of elements erased (0 or 1).
+	 */
+	size_t erase(const Key &key) {
+		std::unique_lock<std::shared_mutex> guard(lock);
+		size_t erased = master.erase(key);
+		if (erased) publish();
+		return erased;
+	}
+
+	void clear() {
+		std::unique_lock<std::shared_mutex> guard(lock);
+		master.clear();
+		publish();
+	}
+
+	size_t size() const {
+		std::shared_lock<std::shared_mutex> guard(lock);
+		return master.size();
+	}
+
+	/**
+	 * the number of published writes so far, plus one.
+	 */
+	unsigned long long version() const {
+		return current_version.load(std::memory_order_acquire);
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,368 @@
+/**
+ * streaming serialization of linked_hashmap in insertion order
+ */
+#ifndef SJTU_LINKEDHASHMAP_SERIALIZE_HPP
+#define SJTU_LINKEDHASHMAP_SERIALIZE_HPP
+
+#include "linked_hashmap.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <unistd.h>
+
+namespace sjtu {
+    /**
+     * The stream format is
+     *   magic (4 bytes) | element count (varint) | key, value | key, value | ...
+     * with every key and value written by codec<Key> and codec<T>, in the
+     * insertion order of the map. The count comes first, so the reader can
+     * size the map once and never rehash while loading.
+     *
+     * Streams go through two small concepts:
+     *   a sink has   void write(const void *data, size_t size);
+     *   a source has size_t read(void *data, size_t size);  (0 at the end)
+     * file_sink/file_source wrap a FILE *, fd_sink/fd_source a descriptor
+     * (pipes, sockets). serialize/deserialize buffer them in chunks, so a
+     * codec may write a byte at a time.
+     *
+     * The reader may run ahead of the map by up to a chunk. To read more
+     * than one map (or anything after one) from a stream, make one
+     * buffered_reader over it and pass that to every deserialize.
+     */
+
+    /**
+     * packs writes into CHUNK-byte writes of the sink.
+     */
+template<class Sink>
+class buffered_writer {
+public:
+	static const size_t CHUNK = 1 << 16;
+
+private:
+	Sink &sink;
+	char *buffer;
+	size_t used;
+
+public:
+	explicit buffered_writer(Sink &sink) : sink(sink), buffer(new char[CHUNK]), used(0) {}
+	buffered_writer(const buffered_writer &) = delete;
+	buffered_writer & operator=(const buffered_writer &) = delete;
+
+	/**
+	 * whatever is still buffered is dropped; call flush() first.
+	 */
+	~buffered_writer() {
+		delete [] buffer;
+	}
+
+	void write(const void *data, size_t size) {
+		const char *bytes = static_cast<const char *>(data);
+		if (size >= CHUNK) {
+			flush();
+			sink.write(bytes, size);
+			return;
+		}
+		if (used + size > CHUNK) flush();
+		memcpy(buffer + used, bytes, size);
+		used += size;
+	}
+
+	void put(unsigned char byte) {
+		if (used == CHUNK) flush();
+		buffer[used++] = static_cast<char>(byte);
+	}
+
+	void flush() {
+		if (used) sink.write(buffer, used);
+		used = 0;
+	}
+};
+
+    /**
+     * reads the source CHUNK bytes at a time.
+     * bytes read ahead are kept for its next read, and dropped with it.
+     */
+template<class Source>
+class buffered_reader {
+public:
+	static const size_t CHUNK = 1 << 16;
+
+private:
+	Source &source;
+	char *buffer;
+	size_t begin, end;
+
+	bool refill() {
+		begin = 0;
+		end = source.read(buffer, CHUNK);
+		return end != 0;
+	}
+
+public:
+	explicit buffered_reader(Source &source) : source(source), buffer(new char[CHUNK]), begin(0), end(0) {}
+	buffered_reader(const buffered_reader &) = delete;
+	buffered_reader & operator=(const buffered_reader &) = delete;
+
+	~buffered_reader() {
+		delete [] buffer;
+	}
+
+	/**
+	 * throw runtime_error if the stream ends first.
+	 */
+	void read(void *data, size_t size) {
+		char *bytes = static_cast<char *>(data);
+		while (size) {
+			if (begin == end && !refill()) throw runtime_error();
+			size_t step = end - begin < size ? end - begin : size;
+			memcpy(bytes, buffer + begin, step);
+			begin += step;
+			bytes += step;
+			size -= step;
+		}
+	}
+
+	unsigned char get() {
+		if (begin == end && !refill()) throw runtime_error();
+		return static_cast<unsigned char>(buffer[begin++]);
+	}
+};
+
+    /**
+     * unsigned LEB128: 7 bits per byte, high bit set on all but the last.
+     */
+template<class Writer>
+void write_varint(Writer &out, unsigned long long value) {
+	while (value >= 0x80) {
+		out.put(static_cast<unsigned char>(value | 0x80));
+		value >>= 7;
+	}
+	out.put(static_cast<unsigned char>(value));
+}
+
+template<class Reader>
+unsigned long long read_varint(Reader &in) {
+	unsigned long long value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		unsigned char byte = in.get();
+		value |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) return value;
+	}
+	throw runtime_error();
+}
+
+    /**
+     * codec<T> encodes one T:
+     *   template<class Writer> static void write(Writer &out, const T &value);
+     *   template<class Reader> static T read(Reader &in);
+     * where out.write(data, size)/out.put(byte) and in.read(data, size)/in.get()
+     * are those of buffered_writer/buffered_reader.
+     * Trivially copyable types are copied as raw bytes (native byte order)
+     * and std::string is length-prefixed; specialize codec for other types.
+     */
+template<class T, class Enable = void>
+struct codec {
+	static_assert(std::is_trivially_copyable<T>::value, "no codec for this type: specialize sjtu::codec<T>");
+
+	template<class Writer>
+	static void write(Writer &out, const T &value) {
+		out.write(&value, sizeof(T));
+	}
+
+	template<class Reader>
+	static T read(Reader &in) {
+		alignas(T) unsigned char storage[sizeof(T)];
+		in.read(storage, sizeof(T));
+		T value;
+		memcpy(static_cast<void *>(&value), storage, sizeof(T));
+		return value;
+	}
+};
+
+namespace serialize_detail {
+	/**
+	 * lengths and counts come from the stream, so nothing is allocated for
+	 *   them ahead of the bytes that back it by more than this many items.
+	 */
+	static const size_t STEP = 1 << 16;
+}
+
+    /**
+     * a string is read STEP bytes at a time, so a corrupt length hits the
+     *   end of the stream before it allocates much.
+     */
+template<>
+struct codec<std::string> {
+	template<class Writer>
+	static void write(Writer &out, const std::string &value) {
+		write_varint(out, value.size());
+		out.write(value.data(), value.size());
+	}
+
+	template<class Reader>
+	static std::string read(Reader &in) {
+		std::string value;
+		unsigned long long length = read_varint(in);
+		if (length > value.max_size()) throw runtime_error();
+		while (length) {
+			size_t step = length < serialize_detail::STEP ? static_cast<size_t>(length) : serialize_detail::STEP;
+			size_t done = value.size();
+			value.resize(done + step);
+			in.read(&value[done], step);
+			length -= step;
+		}
+		return value;
+	}
+};
+
+    /**
+     * sinks and sources over a FILE * or a file descriptor.
+     * throw runtime_error when the underlying call fails; a descriptor call
+     *   interrupted by a signal (EINTR) is retried.
+     */
+class file_sink {
+	std::FILE *file;
+
+public:
+	explicit file_sink(std::FILE *file) : file(file) {}
+
+	void write(const void *data, size_t size) {
+		if (std::fwrite(data, 1, size, file) != size) throw runtime_error();
+	}
+};
+
+class file_source {
+	std::FILE *file;
+
+public:
+	explicit file_source(std::FILE *file) : file(file) {}
+
+	size_t read(void *data, size_t size) {
+		size_t got = std::fread(data, 1, size, file);
+		if (got == 0 && std::ferror(file)) throw runtime_error();
+		return got;
+	}
+};
+
+class fd_sink {
+	int fd;
+
+public:
+	explicit fd_sink(int fd) : fd(fd) {}
+
+	void write(const void *data, size_t size) {
+		const char *bytes = static_cast<const char *>(data);
+		while (size) {
+			ssize_t done = ::write(fd, bytes, size);
+			if (done < 0 && errno == EINTR) continue;
+			if (done <= 0) throw runtime_error();
+			bytes += done;
+			size -= static_cast<size_t>(done);
+		}
+	}
+};
+
+class fd_source {
+	int fd;
+
+public:
+	explicit fd_source(int fd) : fd(fd) {}
+
+	size_t read(void *data, size_t size) {
+		ssize_t got;
+		do {
+			got = ::read(fd, data, size);
+		} while (got < 0 && errno == EINTR);
+		if (got < 0) throw runtime_error();
+		return static_cast<size_t>(got);
+	}
+};
+
+namespace serialize_detail {
+	static const char MAGIC[4] = {'S', 'L', 'H', '1'};
+
+	/**
+	 * the key and mapped types of a map whose value_type is pair<const Key, T>.
+	 */
+	template<class Value>
+	struct element_types;
+
+	template<class Key, class T>
+	struct element_types<pair<const Key, T> > {
+		typedef Key key_type;
+		typedef T mapped_type;
+	};
+}
+
+    /**
+     * write map to sink in insertion order, straight from its iterators.
+     * Works for any map with cbegin/cend/size, e.g. compact_linked_hashmap.
+     */
+template<class Map, class Sink>
+void serialize(const Map &map, Sink &sink) {
+	typedef typename Map::value_type value_type;
+	typedef typename serialize_detail::element_types<value_type>::key_type key_type;
+	typedef typename serialize_detail::element_types<value_type>::mapped_type mapped_type;
+
+	buffered_writer<Sink> out(sink);
+	out.write(serialize_detail::MAGIC, sizeof(serialize_detail::MAGIC));
+	write_varint(out, map.size());
+	for (typename Map::const_iterator it = map.cbegin(); it != map.cend(); ++it) {
+		codec<key_type>::write(out, it->first);
+		codec<mapped_type>::write(out, it->second);
+	}
+	out.flush();
+}
+
+    /**
+     * read a stream written by serialize and insert its elements into map,
+     *   after the ones already there, in the streamed order.
+     * The map is reserved ahead of the elements: for all of them at once
+     *   up to serialize_detail::STEP, so loading such a map never rehashes
+     *   (nor runs an incremental migration), and in doubling steps beyond,
+     *   so that a corrupt count cannot force a huge allocation.
+     * in is left just after the map, ready for what follows it.
+     * return the number of elements inserted.
+     * throw runtime_error on a malformed or truncated stream.
+     */
+template<class Map, class Source>
+size_t deserialize(Map &map, buffered_reader<Source> &in) {
+	typedef typename Map::value_type value_type;
+	typedef typename serialize_detail::element_types<value_type>::key_type key_type;
+	typedef typename serialize_detail::element_types<value_type>::mapped_type mapped_type;
+
+	char magic[sizeof(serialize_detail::MAGIC)];
+	in.read(magic, sizeof(magic));
+	if (memcmp(magic, serialize_detail::MAGIC, sizeof(magic)) != 0) throw runtime_error();
+	unsigned long long count = read_varint(in);
+	size_t base = map.size();
+	if (count > static_cast<size_t>(-1) - base) throw runtime_error();
+
+	size_t inserted = 0, reserved = 0;
+	for (unsigned long long i = 0; i < count; ++i) {
+		if (i == reserved) {
+			size_t step = reserved < serialize_detail::STEP ? serialize_detail::STEP : reserved;
+			reserved = count - reserved < step ? static_cast<size_t>(count) : reserved + step;
+			map.reserve(base + reserved);
+		}
+		key_type key = codec<key_type>::read(in);
+		mapped_type value = codec<mapped_type>::read(in);
+		if (map.insert(value_type(std::move(key), std::move(value))).second) ++inserted;
+	}
+	return inserted;
+}
+
+    /**
+     * the same through a buffered_reader of its own: what the reader ran
+     *   ahead past the map is lost, so source must hold nothing more.
+     */
+template<class Map, class Source>
+size_t deserialize(Map &map, Source &source) {
+	buffered_reader<Source> in(source);
+	return deserialize(map, in);
+}
+
+}
+
+#endif
@@ -0,0 +1,408 @@
+/**
+ * on-disk snapshots of linked_hashmap that are queried in place through mmap
+ */
+#ifndef SJTU_LINKEDHASHMAP_SNAPSHOT_HPP
+#define SJTU_LINKEDHASHMAP_SNAPSHOT_HPP
+
+#include "linked_hashmap.hpp"
+#include <cstdio>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sjtu {
+    /**
+     * The snapshot file format (native byte order, checked on load):
+     *
+     *   snapshot_header
+     *   entries[count]         in insertion order, at entries_offset
+     *   buckets[bucket_count]  entry index of each chain head, at buckets_offset
+     *
+     * An entry is its hash, the index of the next entry of its bucket
+     * chain, and the raw bytes of its pair<const Key, T>. Links are indices,
+     * never pointers, so the file means the same wherever it is mapped.
+     *
+     * The hash is pow2_mix_bucket::mix(hash(key)) whatever the policy of
+     * the saved map, with the hash_function() of the map, and the buckets
+     * are indexed by masking it. So the Hash given to load_mmap must give
+     * the same results in the process that loads the file as the one of the
+     * map did in the process that saved it (std::hash of integers does; a
+     * seeded hasher does with its seed).
+     */
+namespace snapshot_detail {
+	static const unsigned long long MAGIC = 0x315048534d484c53ULL;	// "SLHMSHP1"
+	static const unsigned long long ENDIAN_MARK = 0x0102030405060708ULL;
+	static const unsigned long long NONE = ~0ULL;
+	static const size_t ALIGNMENT = 64;
+
+	struct snapshot_header {
+		unsigned long long magic;
+		unsigned long long byte_order;
+		unsigned long long key_size;
+		unsigned long long mapped_size;
+		unsigned long long entry_size;
+		unsigned long long count;
+		unsigned long long bucket_count;
+		unsigned long long entries_offset;
+		unsigned long long buckets_offset;
+		unsigned long long file_size;
+	};
+
+	template<class Key, class T>
+	struct entry {
+		typedef pair<const Key, T> value_type;
+
+		unsigned long long hash;
+		unsigned long long next;
+		alignas(value_type) unsigned char data[sizeof(value_type)];
+
+		const value_type & value() const {
+			return *reinterpret_cast<const value_type *>(data);
+		}
+	};
+
+	inline unsigned long long align_up(unsigned long long offset) {
+		return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	}
+
+	inline unsigned long long bucket_count_for(unsigned long long count) {
+		unsigned long long result = 16;
+		while (result * 3 < count * 4) result <<= 1;
+		return result;
+	}
+
+	inline void write_all(std::FILE *file, const void *data, size_t size) {
+		if (size && std::fwrite(data, 1, size, file) != size) {
+			std::fclose(file);
+			throw runtime_error();
+		}
+	}
+
+	inline void pad_to(std::FILE *file, unsigned long long &offset, unsigned long long target) {
+		static const char zeros[ALIGNMENT] = {};
+		write_all(file, zeros, target - offset);
+		offset = target;
+	}
+}
+
+    /**
+     * write map to path in the snapshot format, replacing the file.
+     * Key and T must be trivially copyable; they are stored as raw bytes.
+     * throw runtime_error if the file cannot be written.
+     */
+template<class Key, class T, class Hash, class Equal, class Allocator, class BucketPolicy, class IndexPolicy, class OrderPolicy>
+void save_snapshot(const linked_hashmap<Key, T, Hash, Equal, Allocator, BucketPolicy, IndexPolicy, OrderPolicy> &map, const char *path) {
+	static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<T>::value,
+		"snapshots store Key and T as raw bytes");
+	using namespace snapshot_detail;
+	typedef entry<Key, T> entry_type;
+	typedef typename linked_hashmap<Key, T, Hash, Equal, Allocator, BucketPolicy, IndexPolicy, OrderPolicy>::const_iterator const_iterator;
+	static_assert(alignof(entry_type) <= ALIGNMENT, "over-aligned entries");
+
+	snapshot_header header;
+	header.magic = MAGIC;
+	header.byte_order = ENDIAN_MARK;
+	header.key_size = sizeof(Key);
+	header.mapped_size = sizeof(T);
+	header.entry_size = sizeof(entry_type);
+	header.count = map.size();
+	header.bucket_count = bucket_count_for(header.count);
+	header.entries_offset = align_up(sizeof(snapshot_header));
+	header.buckets_offset = align_up(header.entries_offset + header.count * sizeof(entry_type));
+	header.file_size = header.buckets_offset + header.bucket_count * sizeof(unsigned long long);
+
+	// chains are built up front, from the same hashes the loader computes
+	Hash hasher = map.hash_function();
+	unsigned long long mask = header.bucket_count - 1;
+	unsigned long long *buckets = new unsigned long long[header.bucket_count];
+	unsigned long long *hashes = new unsigned long long[header.count ? header.count : 1];
+	unsigned long long *next = new unsigned long long[header.count ? header.count : 1];
+	for (unsigned long long i = 0; i < header.bucket_count; ++i) buckets[i] = NONE;
+	unsigned long long index = 0;
+	for (const_iterator it = map.cbegin(); it != map.cend(); ++it, ++index) {
+		hashes[index] = pow2_mix_bucket::mix(hasher(it->first));
+		next[index] = buckets[hashes[index] & mask];
+		buckets[hashes[index] & mask] = index;
+	}
+
+	std::FILE *file = std::fopen(path, "wb");
+	if (!file) {
+		delete [] buckets;
+		delete [] hashes;
+		delete [] next;
+		throw runtime_error();
+	}
+	try {
+		unsigned long long offset = 0;
+		write_all(file, &header, sizeof(header));
+		offset += sizeof(header);
+		pad_to(file, offset, header.entries_offset);
+
+		entry_type record;
+		memset(static_cast<void *>(&record), 0, sizeof(record));
+		index = 0;
+		for (const_iterator it = map.cbegin(); it != map.cend(); ++it, ++index) {
+			record.hash = hashes[index];
+			record.next = next[index];
+			memcpy(record.data, static_cast<const void *>(&*it), sizeof(record.data));
+			write_all(file, &record, sizeof(record));
+		}
+		offset += header.count * sizeof(entry_type);
+		pad_to(file, offset, header.buckets_offset);
+		write_all(file, buckets, header.bucket_count * sizeof(unsigned long long));
+	} catch (...) {
+		delete [] buckets;
+		delete [] hashes;
+		delete [] next;
+		throw;
+	}
+	delete [] buckets;
+	delete [] hashes;
+	delete [] next;
+	if (std::fclose(file) != 0) throw runtime_error();
+}
+
+    /**
+     * a read-only linked_hashmap backed by a snapshot file mapped into memory.
+     * Loading checks the header and maps the file; nothing is deserialized,
+     * so the first lookup can run right away and pages are read on demand.
+     * Iteration follows the saved insertion order exactly.
+     */
+template<
+	class Key,
+	class T,
+	class Hash = std::hash<Key>,
+	class Equal = std::equal_to<Key>
+> class mapped_linked_hashmap {
+public:
+	typedef pair<const Key, T> value_type;
+
+private:
+	typedef snapshot_detail::entry<Key, T> entry_type;
+
+	void *base;
+	size_t length;
+	const entry_type *entries;
+	const unsigned long long *buckets;
+	size_t element_count;
+	size_t mask;
+	Hash hash_func;
+	Equal equal_func;
+
+	mapped_linked_hashmap(void *base, size_t length, const Hash &hash, const Equal &equal)
+		: base(base), length(length), hash_func(hash), equal_func(equal) {
+		const snapshot_detail::snapshot_header *header = static_cast<const snapshot_detail::snapshot_header *>(base);
+		const char *bytes = static_cast<const char *>(base);
+		entries = reinterpret_cast<const entry_type *>(bytes + header->entries_offset);
+		buckets = reinterpret_cast<const unsigned long long *>(bytes + header->buckets_offset);
+		element_count = header->count;
+		mask = header->bucket_count - 1;
+	}
+
+	static bool valid(const snapshot_detail::snapshot_header *header, size_t length) {
+		using namespace snapshot_detail;
+		if (length < sizeof(snapshot_header)) return false;
+		if (header->magic != MAGIC || header->byte_order != ENDIAN_MARK) return false;
+		if (header->key_size != sizeof(Key) || header->mapped_size != sizeof(T) || header->entry_size != sizeof(entry_type)) return false;
+		if (header->bucket_count == 0 || (header->bucket_count & (header->bucket_count - 1))) return false;
+		if (header->file_size != length || header->entries_offset % ALIGNMENT || header->buckets_offset % ALIGNMENT) return false;
+		// each size is bounded by the file before it is multiplied out, so nothing overflows
+		if (header->entries_offset > length || header->buckets_offset > length) return false;
+		if (header->count > (length - header->entries_offset) / sizeof(entry_type)) return false;
+		if (header->bucket_count > (length - header->buckets_offset) / sizeof(unsigned long long)) return false;
+		if (header->entries_offset + header->count * sizeof(entry_type) > header->buckets_offset) return false;
+		return header->buckets_offset + header->bucket_count * sizeof(unsigned long long) <= length;
+	}
+
+	/**
+	 * a chain of the file is only trusted as far as it stays in range:
+	 *   an index past the entries, or more steps than there are entries
+	 *   (a cycle), throws runtime_error.
+	 */
+	const entry_type * find_entry(const Key &key) const {
+		size_t hash = pow2_mix_bucket::mix(hash_func(key));
+		size_t steps = 0;
+		for (unsigned long long i = buckets[hash & mask]; i != snapshot_detail::NONE; i = entries[i].next) {
+			if (i >= element_count || ++steps > element_count) throw runtime_error();
+			if (entries[i].hash == hash && equal_func(entries[i].value().first, key)) return entries + i;
+		}
+		return nullptr;
+	}
+
+public:
+	/**
+	 * steps through the entries in insertion order.
+	 */
+	class const_iterator {
+		friend class mapped_linked_hashmap;
+
+		const entry_type *curr;
+
+		explicit const_iterator(const entry_type *curr) : curr(curr) {}
+
+	public:
+		using difference_type = std::ptrdiff_t;
+		using value_type = typename mapped_linked_hashmap::value_type;
+		using pointer = const value_type *;
+		using reference = const value_type &;
+		using iterator_category = std::bidirectional_iterator_tag;
+
+		const_iterator() : curr(nullptr) {}
+
+		const_iterator & operator++() {
+			++curr;
+			return *this;
+		}
+
+		const_iterator operator++(int) {
+			const_iterator result = *this;
+			++curr;
+			return result;
+		}
+
+		const_iterator & operator--() {
+			--curr;
+			return *this;
+		}
+
+		const_iterator operator--(int) {
+			const_iterator result = *this;
+			--curr;
+			return result;
+		}
+
+		reference operator*() const {
+			return curr->value();
+		}
+
+		pointer operator->() const {
+			return &curr->value();
+		}
+
+		bool operator==(const const_iterator &rhs) const {
+			return curr == rhs.curr;
+		}
+
+		bool operator!=(const const_iterator &rhs) const {
+			return curr != rhs.curr;
+		}
+	};
+
+	/**
+	 * map the snapshot at path, to be looked up with hash and equal.
+	 * throw runtime_error if it cannot be opened or was not written by
+	 *   save_snapshot for this Key and T on this platform.
+	 * Chains are checked while they are walked, not here, so that loading
+	 *   stays O(1): find, count and at throw runtime_error on a corrupt one.
+	 */
+	static mapped_linked_hashmap load_mmap(const char *path, const Hash &hash = Hash(), const Equal &equal = Equal()) {
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0) throw runtime_error();
+		struct stat info;
+		if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+			::close(fd);
+			throw runtime_error();
+		}
+		size_t length = static_cast<size_t>(info.st_size);
+		void *base = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (base == MAP_FAILED) throw runtime_error();
+		if (!valid(static_cast<const snapshot_detail::snapshot_header *>(base), length)) {
+			::munmap(base, length);
+			throw runtime_error();
+		}
+		return mapped_linked_hashmap(base, length, hash, equal);
+	}
+
+	mapped_linked_hashmap(mapped_linked_hashmap &&other) noexcept
+		: base(other.base), length(other.length), entries(other.entries), buckets(other.buckets),
+		  element_count(other.element_count), mask(other.mask), hash_func(other.hash_func), equal_func(other.equal_func) {
+		other.base = nullptr;
+		other.element_count = 0;
+	}
+	mapped_linked_hashmap(const mapped_linked_hashmap &) = delete;
+	mapped_linked_hashmap & operator=(const mapped_linked_hashmap &) = delete;
+	mapped_linked_hashmap & operator=(mapped_linked_hashmap &&) = delete;
+
+	~mapped_linked_hashmap() {
+		if (base) ::munmap(base, length);
+	}
+
+	size_t size() const {
+		return element_count;
+	}
+
+	bool empty() const {
+		return element_count == 0;
+	}
+
+	const_iterator cbegin() const {
+		return const_iterator(entries);
+	}
+
+	const_iterator cend() const {
+		return const_iterator(entries + element_count);
+	}
+
+	const_iterator begin() const {
+		return cbegin();
+	}
+
+	const_iterator end() const {
+		return cend();
+	}
+
+	const_iterator find(const Key &key) const {
+		const entry_type *found = find_entry(key);
+		return found ? const_iterator(found) : cend();
+	}
+
+	size_t count(const Key &key) const {
+		return find_entry(key) ? 1 : 0;
+	}
+
+	/**
+	 * throw index_out_of_bound if key is missing.
+	 */
+	const T & at(const Key &key) const {
+		const entry_type *found = find_entry(key);
+		if (!found) throw index_out_of_bound();
+		return found->value().second;
+	}
+
+	const T & operator[](const Key &key) const {
+		return at(key);
+	}
+
+	/**
+	 * insert every element into map, in order, e.g. to get a writable copy.
+	 * The saved hashes are reused when map caches the same ones, that is
+	 *   when it mixes with pow2_mix_bucket too.
+	 */
+	template<class Allocator, class BucketPolicy, class IndexPolicy, class OrderPolicy>
+	void copy_to(linked_hashmap<Key, T, Hash, Equal, Allocator, BucketPolicy, IndexPolicy, OrderPolicy> &map) const {
+		map.reserve(map.size() + element_count);
+		bool same_hashes = std::is_same<BucketPolicy, pow2_mix_bucket>::value;
+		for (size_t i = 0; i < element_count; ++i) {
+			if (same_hashes) {
+				map.insert_hashed(entries[i].hash, entries[i].value());
+			} else {
+				map.insert(entries[i].value());
+			}
+		}
+	}
+};
+
+    /**
+     * mapped_linked_hashmap<Key, T, Hash, Equal>::load_mmap(path, hash, equal).
+     */
+template<class Key, class T, class Hash = std::hash<Key>, class Equal = std::equal_to<Key> >
+mapped_linked_hashmap<Key, T, Hash, Equal> load_mmap(const char *path, const Hash &hash = Hash(), const Equal &equal = Equal()) {
+	return mapped_linked_hashmap<Key, T, Hash, Equal>::load_mmap(path, hash, equal);
+}
+
+}
+
+#endif
@@ -0,0 +1,199 @@
+/**
+ * an instrumented index engine for linked_hashmap
+ */
+#ifndef SJTU_LINKEDHASHMAP_STATS_HPP
+#define SJTU_LINKEDHASHMAP_STATS_HPP
+
+#include "linked_hashmap.hpp"
+#include <chrono>
+#include <vector>
+
+namespace sjtu {
+    /**
+     * what stats_index has seen since the map was built (or reset_stats()).
+     * A probe is an entry whose cached hash matched, so that Equal was
+     *   called on it: with a good Hash there is about one per hit and none
+     *   per miss, and a Hash that collides shows up as many.
+     * The bucket fields are computed by stats() from the current index.
+     */
+struct index_stats {
+	size_t lookups;
+	size_t hits;
+	size_t probes;
+	size_t max_probes;
+	size_t inserts;
+	size_t erases;
+	size_t rehashes;
+	double rehash_seconds;
+
+	size_t buckets;
+	size_t used_buckets;
+	size_t max_chain;
+	double mean_chain;
+
+	size_t misses() const {
+		return lookups - hits;
+	}
+
+	double hit_ratio() const {
+		return lookups ? static_cast<double>(hits) / lookups : 0.0;
+	}
+
+	double mean_probes() const {
+		return lookups ? static_cast<double>(probes) / lookups : 0.0;
+	}
+};
+
+    /**
+     * IndexPolicy that wraps another engine and counts what happens in it:
+     *   linked_hashmap<Key, T, Hash, Equal, Allocator, BucketPolicy, stats_index<chained_index> >
+     * then offers stats(), bucket_histogram() and reset_stats().
+     * The statistics are chosen at compile time: with the plain engine none
+     *   of this code exists, and those members are not declared.
+     *
+     * Every node links one insert, so inserts also counts node allocations,
+     *   and rehashes counts bucket array allocations. Growth is timed around
+     *   every prepare_insert, which is all the instrumented map pays besides
+     *   its counters.
+     * find updates the counters of a const map, so even readers of one
+     *   instrumented map must not run concurrently.
+     */
+template<class Inner = chained_index>
+struct stats_index {
+	template<class Node>
+	using hook = typename Inner::template hook<Node>;
+
+	template<class Node, class BucketPolicy, class Allocator>
+	class table : public Inner::template table<Node, BucketPolicy, Allocator> {
+	private:
+		typedef typename Inner::template table<Node, BucketPolicy, Allocator> base;
+		typedef std::chrono::steady_clock clock;
+
+		struct counters {
+			size_t lookups;
+			size_t hits;
+			size_t probes;
+			size_t max_probes;
+			size_t inserts;
+			size_t erases;
+			size_t rehashes;
+			double rehash_seconds;
+		};
+
+		mutable counters stat;
+
+		/**
+		 * the predicate of the map, counting its calls.
+		 */
+		template<class Pred>
+		struct counting : Pred {
+			size_t *calls;
+
+			counting(const Pred &pred, size_t *calls) : Pred(pred), calls(calls) {}
+
+			bool operator()(const Node *node) const {
+				++*calls;
+				return Pred::operator()(node);
+			}
+		};
+
+		void reset() noexcept {
+			counters zero = {0, 0, 0, 0, 0, 0, 0, 0.0};
+			stat = zero;
+		}
+
+		void record_rehash(clock::time_point start) {
+			++stat.rehashes;
+			stat.rehash_seconds += std::chrono::duration<double>(clock::now() - start).count();
+		}
+
+	public:
+		explicit table(const Allocator &a = Allocator()) noexcept : base(a) {
+			reset();
+		}
+
+		void swap(table &other) noexcept {
+			base::swap(other);
+			std::swap(stat, other.stat);
+		}
+
+		template<class Pred>
+		Node* find(size_t hash, Pred pred) const {
+			size_t probes = 0;
+			Node *node = base::find(hash, counting<Pred>(pred, &probes));
+			++stat.lookups;
+			if (node) ++stat.hits;
+			stat.probes += probes;
+			if (probes > stat.max_probes) stat.max_probes = probes;
+			return node;
+		}
+
+		void insert(Node *node) {
+			++stat.inserts;
+			base::insert(node);
+		}
+
+		void erase(Node *node) {
+			++stat.erases;
+			base::erase(node);
+		}
+
+		void rehash(size_t n) {
+			clock::time_point start = clock::now();
+			base::rehash(n);
+			record_rehash(start);
+		}
+
+		/**
+		 * counts a rehash when the bucket count changes; the same-size
+		 *   cleanup rehash of swiss_index is not seen.
+		 */
+		void prepare_insert(size_t size) {
+			size_t before = base::bucket_count();
+			clock::time_point start = clock::now();
+			base::prepare_insert(size);
+			if (base::bucket_count() != before) record_rehash(start);
+		}
+
+		index_stats stats() const {
+			index_stats result;
+			result.lookups = stat.lookups;
+			result.hits = stat.hits;
+			result.probes = stat.probes;
+			result.max_probes = stat.max_probes;
+			result.inserts = stat.inserts;
+			result.erases = stat.erases;
+			result.rehashes = stat.rehashes;
+			result.rehash_seconds = stat.rehash_seconds;
+			result.buckets = 0;
+			result.used_buckets = 0;
+			result.max_chain = 0;
+			size_t entries = 0;
+			base::for_each_bucket([&](size_t length) {
+				++result.buckets;
+				if (length) ++result.used_buckets;
+				if (length > result.max_chain) result.max_chain = length;
+				entries += length;
+			});
+			result.mean_chain = result.used_buckets ? static_cast<double>(entries) / result.used_buckets : 0.0;
+			return result;
+		}
+
+		std::vector<size_t> bucket_histogram() const {
+			std::vector<size_t> result;
+			base::for_each_bucket([&](size_t length) {
+				if (length >= result.size()) result.resize(length + 1, 0);
+				++result[length];
+			});
+			return result;
+		}
+
+		void reset_stats() {
+			reset();
+		}
+	};
+};
+
+}
+
+#endif
@@ -0,0 +1,172 @@
+/**
+ * multi-threaded scans and bulk loads of linked_hashmap
+ */
+#ifndef SJTU_PARALLEL_LINKEDHASHMAP_HPP
+#define SJTU_PARALLEL_LINKEDHASHMAP_HPP
+
+#include "linked_hashmap.hpp"
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace sjtu {
+    /**
+     * Helpers that spread work over threads. The maps themselves stay
+     * single-threaded; these only call their const members (and the
+     * caller's callback) from several threads at once.
+     *
+     * threads == 0 means std::thread::hardware_concurrency(). The calling
+     * thread works too, so threads - 1 threads are started.
+     */
+namespace parallel_detail {
+	inline size_t thread_count(size_t threads) {
+		if (threads == 0) threads = std::thread::hardware_concurrency();
+		return threads ? threads : 1;
+	}
+
+	/**
+	 * run work(chunk) for every chunk in [0, chunks) on threads threads.
+	 * Idle threads take the next chunk from a shared counter, so a slow
+	 *   chunk does not hold up the others. The first exception is rethrown
+	 *   once every thread is done.
+	 */
+	template<class Work>
+	void run_chunks(size_t chunks, size_t threads, Work work) {
+		std::atomic<size_t> next(0);
+		std::exception_ptr failure;
+		std::atomic<bool> failed(false);
+		auto worker = [&]() {
+			for (size_t chunk; (chunk = next.fetch_add(1)) < chunks; ) {
+				try {
+					work(chunk);
+				} catch (...) {
+					if (!failed.exchange(true)) failure = std::current_exception();
+					next.store(chunks);
+				}
+			}
+		};
+		std::vector<std::thread> pool;
+		size_t extra = threads < chunks ? threads - 1 : (chunks ? chunks - 1 : 0);
+		for (size_t i = 0; i < extra; ++i) pool.push_back(std::thread(worker));
+		worker();
+		for (size_t i = 0; i < pool.size(); ++i) pool[i].join();
+		if (failure) std::rethrow_exception(failure);
+	}
+
+	static const size_t CHUNKS_PER_THREAD = 8;
+
+	/**
+	 * cut [first, last) of size n into about chunks pieces; result[i] and
+	 *   result[i + 1] bound piece i. One pass over the links, with no callback.
+	 */
+	template<class Iterator>
+	std::vector<Iterator> split(Iterator first, Iterator last, size_t n, size_t chunks) {
+		std::vector<Iterator> bounds;
+		size_t stride = (n + chunks - 1) / chunks;
+		if (stride == 0) stride = 1;
+		size_t i = 0;
+		for (Iterator it = first; it != last; ++it, ++i) {
+			if (i % stride == 0) bounds.push_back(it);
+		}
+		bounds.push_back(last);
+		return bounds;
+	}
+
+	template<class Iterator, class F>
+	void for_each_range(Iterator first, Iterator last, size_t n, F &fn, size_t threads) {
+		threads = thread_count(threads);
+		if (threads == 1 || n < 2) {
+			for (Iterator it = first; it != last; ++it) fn(*it);
+			return;
+		}
+		std::vector<Iterator> bounds = split(first, last, n, threads * CHUNKS_PER_THREAD);
+		run_chunks(bounds.size() - 1, threads, [&](size_t chunk) {
+			for (Iterator it = bounds[chunk]; it != bounds[chunk + 1]; ++it) fn(*it);
+		});
+	}
+
+	template<class Map, class F, class = void>
+	struct has_slices : std::false_type {};
+
+	template<class Map, class F>
+	struct has_slices<Map, F, typename void_type<decltype(
+		std::declval<Map &>().for_each_in_slice(size_t(), size_t(), std::declval<F &>()))>::type> : std::true_type {};
+
+	/**
+	 * every thread finds its own chunks through the index: nothing walks
+	 *   the order list first.
+	 */
+	template<class Map, class F>
+	void for_each(Map &map, F &fn, size_t threads, std::true_type) {
+		threads = thread_count(threads);
+		if (threads == 1 || map.size() < 2) {
+			map.for_each_in_slice(0, 1, std::ref(fn));
+			return;
+		}
+		size_t chunks = threads * CHUNKS_PER_THREAD;
+		run_chunks(chunks, threads, [&](size_t chunk) {
+			map.for_each_in_slice(chunk, chunks, std::ref(fn));
+		});
+	}
+
+	template<class Map, class F>
+	void for_each(Map &map, F &fn, size_t threads, std::false_type) {
+		for_each_range(map.begin(), map.end(), map.size(), fn, threads);
+	}
+}
+
+    /**
+     * call fn(element) on every element of map, from up to threads threads,
+     * so fn must be safe to call concurrently on different elements.
+     * There is no order across chunks. linked_hashmap and
+     * compact_linked_hashmap cut the work by slices of their tables
+     * (for_each_in_slice), which every thread scans on its own; within a
+     * chunk, linked_hashmap visits its elements in index order and
+     * compact_linked_hashmap in insertion order.
+     * Any other map with forward iterators and size() is cut into chunks
+     * by one serial pass over its iterators first.
+     */
+template<class Map, class F>
+void parallel_for_each(Map &map, F fn, size_t threads = 0) {
+	parallel_detail::for_each(map, fn, threads, parallel_detail::has_slices<Map, F>());
+}
+
+template<class Map, class F>
+void parallel_for_each(const Map &map, F fn, size_t threads = 0) {
+	parallel_detail::for_each(map, fn, threads, parallel_detail::has_slices<const Map, F>());
+}
+
+    /**
+     * insert values[0, n) into map in order, as insert() on each would.
+     * The keys are hashed in parallel first (Hash must allow concurrent
+     * calls); linking nodes in order and into their buckets is cheap next
+     * to that, and is done by the calling thread with everything reserved
+     * up front.
+     * return the number of values inserted.
+     */
+template<class Key, class T, class Hash, class Equal, class Allocator, class BucketPolicy, class IndexPolicy, class OrderPolicy>
+size_t build_from(linked_hashmap<Key, T, Hash, Equal, Allocator, BucketPolicy, IndexPolicy, OrderPolicy> &map,
+	const pair<const Key, T> *values, size_t n, size_t threads = 0) {
+	threads = parallel_detail::thread_count(threads);
+	std::vector<size_t> hashes(n);
+	size_t chunks = threads * parallel_detail::CHUNKS_PER_THREAD;
+	size_t stride = n / chunks + 1;
+	const linked_hashmap<Key, T, Hash, Equal, Allocator, BucketPolicy, IndexPolicy, OrderPolicy> &view = map;
+	parallel_detail::run_chunks((n + stride - 1) / stride, threads, [&](size_t chunk) {
+		size_t end = (chunk + 1) * stride < n ? (chunk + 1) * stride : n;
+		for (size_t i = chunk * stride; i < end; ++i) hashes[i] = view.hash_code(values[i].first);
+	});
+
+	map.reserve(map.size() + n);
+	size_t inserted = 0;
+	for (size_t i = 0; i < n; ++i) {
+		if (map.insert_hashed(hashes[i], values[i]).second) ++inserted;
+	}
+	return inserted;
+}
+
+}
+
+#endif
@@ -0,0 +1,551 @@
+/**
+ * a linked_hashmap for one writer and many lock-free readers
+ */
+#ifndef SJTU_RCU_LINKEDHASHMAP_HPP
+#define SJTU_RCU_LINKEDHASHMAP_HPP
+
+#include "linked_hashmap.hpp"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sjtu {
+    /**
+     * Epoch-based reclamation for one data structure.
+     *
+     * A reader pins the current epoch for as long as it looks at shared
+     * memory (a read_guard). The writer unlinks an object first and retires
+     * it second, tagged with the epoch of the moment; it is freed only once
+     * every pinned reader has a later epoch, i.e. started after the unlink
+     * and can no longer reach it.
+     *
+     * Pinning claims one of READER_SLOTS slots with a single CAS on its own
+     * cache line; with more concurrent readers than slots, the extra ones
+     * spin until a slot frees up.
+     *
+     * Several writers (of different maps sharing the domain) may retire
+     * and reclaim at once: the list of retired objects has a lock of its
+     * own, which readers never take.
+     */
+class epoch_domain {
+public:
+	static const size_t READER_SLOTS = 128;
+
+private:
+	struct alignas(64) Slot {
+		std::atomic<unsigned long long> epoch;
+		std::atomic<bool> busy;
+
+		Slot() : epoch(0), busy(false) {}
+	};
+
+	struct Retired {
+		void *ptr;
+		void (*destroy)(void *);
+		unsigned long long epoch;
+	};
+
+	Slot slots[READER_SLOTS];
+	std::atomic<unsigned long long> global_epoch;
+	mutable std::mutex limbo_lock;
+	std::vector<Retired> limbo;
+
+	size_t pin() {
+		size_t slot = std::hash<std::thread::id>()(std::this_thread::get_id()) % READER_SLOTS;
+		for (size_t tries = 1; ; ++tries, slot = (slot + 1) % READER_SLOTS) {
+			bool expected = false;
+			if (!slots[slot].busy.load(std::memory_order_relaxed) &&
+				slots[slot].busy.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+				slots[slot].epoch.store(global_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				return slot;
+			}
+			if (tries % READER_SLOTS == 0) std::this_thread::yield();
+		}
+	}
+
+	void unpin(size_t slot) {
+		slots[slot].epoch.store(0, std::memory_order_release);
+		slots[slot].busy.store(false, std::memory_order_release);
+	}
+
+public:
+	/**
+	 * keeps everything reachable at its construction alive until it is destroyed.
+	 */
+	class read_guard {
+		friend class epoch_domain;
+
+		epoch_domain *domain;
+		size_t slot;
+
+		explicit read_guard(epoch_domain *domain) : domain(domain), slot(domain->pin()) {}
+
+	public:
+		read_guard(read_guard &&other) noexcept : domain(other.domain), slot(other.slot) {
+			other.domain = nullptr;
+		}
+		read_guard(const read_guard &) = delete;
+		read_guard & operator=(const read_guard &) = delete;
+		read_guard & operator=(read_guard &&) = delete;
+
+		~read_guard() {
+			if (domain) domain->unpin(slot);
+		}
+	};
+
+	epoch_domain() : global_epoch(1) {}
+	epoch_domain(const epoch_domain &) = delete;
+	epoch_domain & operator=(const epoch_domain &) = delete;
+
+	/**
+	 * no reader may be pinned any more.
+	 */
+	~epoch_domain() {
+		for (size_t i = 0; i < limbo.size(); ++i) limbo[i].destroy(limbo[i].ptr);
+	}
+
+	read_guard pin_reader() {
+		return read_guard(this);
+	}
+
+	/**
+	 * free ptr with destroy(ptr) once no reader can see it.
+	 * ptr must already be unreachable for readers that pin from now on.
+	 */
+	void retire(void *ptr, void (*destroy)(void *)) {
+		std::lock_guard<std::mutex> lock(limbo_lock);
+		Retired item = {ptr, destroy, global_epoch.load(std::memory_order_relaxed)};
+		limbo.push_back(item);
+	}
+
+	size_t pending() const {
+		std::lock_guard<std::mutex> lock(limbo_lock);
+		return limbo.size();
+	}
+
+	/**
+	 * start a new epoch and free what no pinned reader can see.
+	 */
+	void reclaim() {
+		std::lock_guard<std::mutex> lock(limbo_lock);
+		unsigned long long current = global_epoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		unsigned long long oldest = current;
+		for (size_t i = 0; i < READER_SLOTS; ++i) {
+			unsigned long long epoch = slots[i].epoch.load(std::memory_order_acquire);
+			if (epoch && epoch < oldest) oldest = epoch;
+		}
+		size_t kept = 0;
+		for (size_t i = 0; i < limbo.size(); ++i) {
+			if (limbo[i].epoch < oldest) {
+				limbo[i].destroy(limbo[i].ptr);
+			} else {
+				limbo[kept++] = limbo[i];
+			}
+		}
+		limbo.resize(kept);
+	}
+};
+
+    /**
+     * rcu_linked_hashmap keeps insertion order like linked_hashmap, but its
+     * readers (find, count, for_each) never lock and never write shared
+     * memory other than their own epoch slot. Writers (insert, erase, ...)
+     * are serialized by a mutex, so one writer thread never waits.
+     *
+     * The index is an open-addressing table of node pointers, published
+     * through one atomic pointer: a rehash builds a whole new table and swaps
+     * it in, so a reader sees either the old table or the new one. The
+     * insertion order is a list of atomic next links, so an ordered traversal
+     * may run while the writer appends and unlinks around it. Erased nodes
+     * and replaced tables are freed through an epoch_domain.
+     *
+     * Values are never changed in place: insert_or_assign puts a new node at
+     * the position of the old one. A reader therefore sees a whole old value
+     * or a whole new one.
+     *
+     * Each map has an epoch_domain of its own (READER_SLOTS cache lines),
+     * unless it is given one to share, as the shards of
+     * concurrent_linked_hashmap are.
+     */
+template<
+	class Key,
+	class T,
+	class Hash = std::hash<Key>,
+	class Equal = std::equal_to<Key>
+> class rcu_linked_hashmap {
+public:
+	typedef pair<const Key, T> value_type;
+	typedef epoch_domain::read_guard read_guard;
+
+private:
+	struct Node {
+		std::atomic<Node *> next;
+		Node *prev;
+		size_t hash;
+		value_type data;
+
+		template<class... Args>
+		Node(size_t hash, Args&&... args) : next(nullptr), prev(nullptr), hash(hash), data(std::forward<Args>(args)...) {}
+	};
+
+	/**
+	 * linear probing over a power-of-two capacity, kept at most half used
+	 *   (tombstones included), so every probe meets a null slot.
+	 */
+	struct Table {
+		size_t capacity;
+		std::atomic<Node *> *slots;
+
+		explicit Table(size_t capacity) : capacity(capacity), slots(new std::atomic<Node *>[capacity]) {
+			for (size_t i = 0; i < capacity; ++i) slots[i].store(nullptr, std::memory_order_relaxed);
+		}
+
+		~Table() {
+			delete [] slots;
+		}
+	};
+
+	static const size_t MIN_CAPACITY = 16;
+	/**
+	 * the writer tries to reclaim after this many retirements.
+	 */
+	static const size_t RECLAIM_BATCH = 64;
+
+	static Node * tombstone() {
+		static char marker;
+		return reinterpret_cast<Node *>(&marker);
+	}
+
+	static void destroy_node(void *node) {
+		delete static_cast<Node *>(node);
+	}
+
+	static void destroy_table(void *table) {
+		delete static_cast<Table *>(table);
+	}
+
+	epoch_domain *epochs;
+	bool owns_epochs;
+	std::atomic<Table *> table;
+	std::atomic<Node *> first;
+	std::atomic<size_t> element_count;
+	Node *last;
+	size_t used;
+	size_t retired_since_reclaim;
+	Hash hash_func;
+	Equal equal_func;
+	std::mutex writer;
+
+	size_t hash_of(const Key &key) const {
+		return pow2_mix_bucket::mix(hash_func(key));
+	}
+
+	Node * find_node(const Table *t, const Key &key, size_t hash) const {
+		size_t mask = t->capacity - 1;
+		for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+			Node *node = t->slots[i].load(std::memory_order_acquire);
+			if (!node) return nullptr;
+			if (node != tombstone() && node->hash == hash && equal_func(node->data.first, key)) return node;
+		}
+	}
+
+	/**
+	 * writer only: the slot holding node, or where a node of hash would go.
+	 */
+	size_t slot_of(const Table *t, const Key &key, size_t hash, bool &found) const {
+		size_t mask = t->capacity - 1, free_slot = t->capacity;
+		for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+			Node *node = t->slots[i].load(std::memory_order_relaxed);
+			if (!node) {
+				found = false;
+				return free_slot < t->capacity ? free_slot : i;
+			}
+			if (node == tombstone()) {
+				if (free_slot == t->capacity) free_slot = i;
+			} else if (node->hash == hash && equal_func(node->data.first, key)) {
+				found = true;
+				return i;
+			}
+		}
+	}
+
+	/**
+	 * writer only: build a table of capacity for the live nodes and publish it.
+	 */
+	void rebuild(size_t capacity) {
+		Table *old = table.load(std::memory_order_relaxed);
+		Table *fresh = new Table(capacity);
+		size_t mask = capacity - 1;
+		for (Node *node = first.load(std::memory_order_relaxed); node; node = node->next.load(std::memory_order_relaxed)) {
+			size_t i = node->hash & mask;
+			while (fresh->slots[i].load(std::memory_order_relaxed)) i = (i + 1) & mask;
+			fresh->slots[i].store(node, std::memory_order_relaxed);
+		}
+		table.store(fresh, std::memory_order_release);
+		used = element_count.load(std::memory_order_relaxed);
+		retire(old, destroy_table);
+	}
+
+	static size_t capacity_for(size_t count) {
+		size_t capacity = MIN_CAPACITY;
+		while (capacity < count * 2 + 2) capacity <<= 1;
+		return capacity;
+	}
+
+	/**
+	 * writer only: make sure one more slot may be used.
+	 */
+	void prepare_insert() {
+		Table *t = table.load(std::memory_order_relaxed);
+		if ((used + 1) * 2 <= t->capacity) return;
+		rebuild(capacity_for(element_count.load(std::memory_order_relaxed) + 1));
+	}
+
+	void retire(void *ptr, void (*destroy)(void *)) {
+		epochs->retire(ptr, destroy);
+		if (++retired_since_reclaim >= RECLAIM_BATCH) {
+			retired_since_reclaim = 0;
+			epochs->reclaim();
+		}
+	}
+
+	void append(Node *node) {
+		node->prev = last;
+		if (last) {
+			last->next.store(node, std::memory_order_release);
+		} else {
+			first.store(node, std::memory_order_release);
+		}
+		last = node;
+	}
+
+	/**
+	 * put fresh where old is in the order; readers standing on old still see
+	 *   the rest of the list through old->next.
+	 */
+	void replace_in_order(Node *old, Node *fresh) {
+		Node *next = old->next.load(std::memory_order_relaxed);
+		fresh->prev = old->prev;
+		fresh->next.store(next, std::memory_order_relaxed);
+		if (old->prev) {
+			old->prev->next.store(fresh, std::memory_order_release);
+		} else {
+			first.store(fresh, std::memory_order_release);
+		}
+		if (next) {
+			next->prev = fresh;
+		} else {
+			last = fresh;
+		}
+	}
+
+	void unlink_from_order(Node *node) {
+		Node *next = node->next.load(std::memory_order_relaxed);
+		if (node->prev) {
+			node->prev->next.store(next, std::memory_order_release);
+		} else {
+			first.store(next, std::memory_order_release);
+		}
+		if (next) {
+			next->prev = node->prev;
+		} else {
+			last = node->prev;
+		}
+	}
+
+	template<class... Args>
+	bool insert_locked(const Key &key, size_t hash, Args&&... args) {
+		prepare_insert();
+		Table *t = table.load(std::memory_order_relaxed);
+		bool found;
+		size_t slot = slot_of(t, key, hash, found);
+		if (found) return false;
+		Node *node = new Node(hash, std::forward<Args>(args)...);
+		if (!t->slots[slot].load(std::memory_order_relaxed)) ++used;
+		append(node);
+		t->slots[slot].store(node, std::memory_order_release);
+		element_count.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+public:
+	rcu_linked_hashmap()
+		: epochs(new epoch_domain()), owns_epochs(true), table(new Table(MIN_CAPACITY)), first(nullptr),
+		  element_count(0), last(nullptr), used(0), retired_since_reclaim(0) {}
+
+	/**
+	 * a map whose retired nodes go to shared, which must outlive it.
+	 */
+	explicit rcu_linked_hashmap(epoch_domain &shared)
+		: epochs(&shared), owns_epochs(false), table(new Table(MIN_CAPACITY)), first(nullptr),
+		  element_count(0), last(nullptr), used(0), retired_since_reclaim(0) {}
+
+	rcu_linked_hashmap(const rcu_linked_hashmap &) = delete;
+	rcu_linked_hashmap & operator=(const rcu_linked_hashmap &) = delete;
+
+	/**
+	 * no reader may still be running.
+	 */
+	~rcu_linked_hashmap() {
+		Node *node = first.load(std::memory_order_relaxed);
+		while (node) {
+			Node *next = node->next.load(std::memory_order_relaxed);
+			delete node;
+			node = next;
+		}
+		delete table.load(std::memory_order_relaxed);
+		if (owns_epochs) delete epochs;
+	}
+
+	/**
+	 * pin the current state for a reader: whatever find(key, guard) returns
+	 *   stays valid while the guard lives. Keep guards short, since nothing
+	 *   retired after the pin can be freed until it is dropped.
+	 */
+	read_guard pin() const {
+		return epochs->pin_reader();
+	}
+
+	/**
+	 * the value of key, or nullptr; valid as long as guard lives.
+	 */
+	const T * find(const Key &key, const read_guard &guard) const {
+		(void)guard;
+		Node *node = find_node(table.load(std::memory_order_acquire), key, hash_of(key));
+		return node ? &node->data.second : nullptr;
+	}
+
+	/**
+	 * copy the value of key into out; return false if key is missing.
+	 */
+	bool find(const Key &key, T &out) const {
+		read_guard guard = pin();
+		const T *value = find(key, guard);
+		if (!value) return false;
+		out = *value;
+		return true;
+	}
+
+	size_t count(const Key &key) const {
+		read_guard guard = pin();
+		return find(key, guard) ? 1 : 0;
+	}
+
+	/**
+	 * call f(const Key &, const T &) on the elements in insertion order.
+	 * Runs alongside the writer: it sees every element that stays in the map
+	 *   throughout, and any mix of the elements inserted or erased meanwhile.
+	 */
+	template<class F>
+	void for_each(F f) const {
+		read_guard guard = pin();
+		for (Node *node = first.load(std::memory_order_acquire); node; node = node->next.load(std::memory_order_acquire)) {
+			f(node->data.first, node->data.second);
+		}
+	}
+
+	size_t size() const {
+		return element_count.load(std::memory_order_relaxed);
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	/**
+	 * insert (key, value) unless key is present; return true if inserted.
+	 */
+	bool insert(const Key &key, const T &value) {
+		std::lock_guard<std::mutex> lock(writer);
+		return insert_locked(key, hash_of(key), key, value);
+	}
+
+	template<class... Args>
+	bool try_emplace(const Key &key, Args&&... args) {
+		std::lock_guard<std::mutex> lock(writer);
+		return insert_locked(key, hash_of(key), key, T(std::forward<Args>(args)...));
+	}
+
+	/**
+	 * insert (key, value), or replace the value of key keeping its position.
+	 * return true if it was inserted.
+	 */
+	template<class M>
+	bool insert_or_assign(const Key &key, M &&value) {
+		std::lock_guard<std::mutex> lock(writer);
+		size_t hash = hash_of(key);
+		Table *t = table.load(std::memory_order_relaxed);
+		bool found;
+		size_t slot = slot_of(t, key, hash, found);
+		if (!found) return insert_locked(key, hash, key, std::forward<M>(value));
+
+		Node *old = t->slots[slot].load(std::memory_order_relaxed);
+		Node *fresh = new Node(hash, key, std::forward<M>(value));
+		replace_in_order(old, fresh);
+		t->slots[slot].store(fresh, std::memory_order_release);
+		retire(old, destroy_node);
+		return false;
+	}
+
+	/**
+	 * return the number of elements erased (0 or 1).
+	 */
+	size_t erase(const Key &key) {
+		std::lock_guard<std::mutex> lock(writer);
+		size_t hash = hash_of(key);
+		Table *t = table.load(std::memory_order_relaxed);
+		bool found;
+		size_t slot = slot_of(t, key, hash, found);
+		if (!found) return 0;
+
+		Node *node = t->slots[slot].load(std::memory_order_relaxed);
+		t->slots[slot].store(tombstone(), std::memory_order_release);
+		unlink_from_order(node);
+		element_count.fetch_sub(1, std::memory_order_relaxed);
+		retire(node, destroy_node);
+		return 1;
+	}
+
+	void clear() {
+		std::lock_guard<std::mutex> lock(writer);
+		Node *node = first.load(std::memory_order_relaxed);
+		first.store(nullptr, std::memory_order_release);
+		last = nullptr;
+		element_count.store(0, std::memory_order_relaxed);
+		rebuild(MIN_CAPACITY);
+		while (node) {
+			Node *next = node->next.load(std::memory_order_relaxed);
+			retire(node, destroy_node);
+			node = next;
+		}
+	}
+
+	/**
+	 * make room for count elements, so inserting them never rebuilds the table.
+	 */
+	void reserve(size_t count) {
+		std::lock_guard<std::mutex> lock(writer);
+		size_t capacity = capacity_for(count);
+		if (capacity > table.load(std::memory_order_relaxed)->capacity) rebuild(capacity);
+	}
+
+	/**
+	 * free whatever retired memory no reader can see any more.
+	 * The writer does this on its own every RECLAIM_BATCH retirements.
+	 */
+	void reclaim() {
+		std::lock_guard<std::mutex> lock(writer);
+		epochs->reclaim();
+	}
+
+	size_t pending_reclamation() const {
+		return epochs->pending();
+	}
+};
+
+}
+
+#endif